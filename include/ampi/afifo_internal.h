@@ -25,6 +25,7 @@
 #pragma once
 
 #include "common_utils.h"
+#include <algorithm>
 
 namespace ampi
 {
@@ -86,11 +87,81 @@ namespace ampi
     return result;
     }
     
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // afifo_drain_iterator_tmpl
+  //
+  // owns detached list which is already accounted in size of queue, push order is restored lazily with single reversal
+  // pass on first pull so detaching stays O(1), following node is prefetched while elements are handed out.
+  // List which drain had to walk for its length is reversed in that walk and handed over already in fifo order.
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class afifo_drain_iterator_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using node_type = lifo_node_t<user_obj_type>;
+    using pointer_type = node_type *;
+
+  protected:
+    node_type * linked_list_;
+    bool        reversed_;
+
+  public:
+    afifo_drain_iterator_tmpl() noexcept : linked_list_{}, reversed_{} {}
+    explicit afifo_drain_iterator_tmpl( node_type * linked_list, bool reversed = false ) noexcept :
+        linked_list_{linked_list}, reversed_{reversed} {}
+    afifo_drain_iterator_tmpl( afifo_drain_iterator_tmpl && rh ) noexcept;
+    afifo_drain_iterator_tmpl & operator=( afifo_drain_iterator_tmpl && rh ) noexcept { swap( rh ); return *this; }
+
+    bool empty() const noexcept { return linked_list_ == nullptr; }
+
+    ///\returns next node in fifo order or nullptr when list is exhausted
+    node_type * pull() noexcept;
+    void swap( afifo_drain_iterator_tmpl & rh ) noexcept;
+    };
+
+  template<typename T>
+  afifo_drain_iterator_tmpl<T>::afifo_drain_iterator_tmpl( afifo_drain_iterator_tmpl && rh ) noexcept :
+      linked_list_{rh.linked_list_}, reversed_{rh.reversed_}
+    {
+    rh.linked_list_ = nullptr;
+    rh.reversed_ = false;
+    }
+
+  template<typename T>
+  void afifo_drain_iterator_tmpl<T>::swap( afifo_drain_iterator_tmpl & rh ) noexcept
+    {
+    std::swap(linked_list_,rh.linked_list_);
+    std::swap(reversed_,rh.reversed_);
+    }
+
+  template<typename T>
+  typename afifo_drain_iterator_tmpl<T>::node_type *
+  afifo_drain_iterator_tmpl<T>::pull() noexcept
+    {
+    if( !reversed_ )
+      {
+      linked_list_ = afifo_internal_tmpl<T>::reverse( linked_list_ );
+      reversed_ = true;
+      }
+    node_type * result { linked_list_ };
+    if( result != nullptr )
+      {
+      linked_list_ = result->next;
+      if( linked_list_ != nullptr )
+        __builtin_prefetch( linked_list_ );
+      }
+    return result;
+    }
+
   //----------------------------------------------------------------------------------------------------------------------
   //
   // afifo_internal_tmpl
   // aggregated pop queue
   //
+  // head word packs node address without its alignment bits with 20bit length of list (saturating at
+  // max_counted_length), so detached list is accounted in size without walking it
   //----------------------------------------------------------------------------------------------------------------------
 
   ///\brief lifo aggregated pop queue used internaly for node managment
@@ -102,15 +173,35 @@ namespace ampi
     using node_type = lifo_node_t<user_obj_type>;
     using pointer_type = node_type *;
     using size_type = long;
+    static constexpr unsigned length_bits = 20;
+    static constexpr uint64_t max_counted_length = ( uint64_t{1} << length_bits ) - 1;
     
   private:
-    std::atomic<pointer_type> head_;
+    static_assert( alignof(node_type) >= 8, "head word drops 3 alignment bits of node address" );
+    static constexpr unsigned address_bits = 64 - length_bits;
+
+    struct head_type
+      {
+      uint64_t value;
+
+      node_type * get() const noexcept
+        { return reinterpret_cast<node_type *>( ( value & ( ( uint64_t{1} << address_bits ) - 1 ) ) << 3 ); }
+      uint64_t    length() const noexcept { return value >> address_bits; }
+      static head_type make( node_type * node, uint64_t length ) noexcept
+        {
+        // user space address below 2^47
+        assert( ( reinterpret_cast<uintptr_t>( node ) >> ( address_bits + 3 ) ) == 0 );
+        return head_type{ ( reinterpret_cast<uintptr_t>( node ) >> 3 ) | ( std::min( length, max_counted_length ) << address_bits ) };
+        }
+      };
+
+    head_type              head_;
     std::atomic<size_type> size_;
 
     bool           finish_wating_;
     
   public:
-    inline bool        empty() const noexcept                  { return head_.load( std::memory_order_acquire) == nullptr; }
+    inline bool        empty() const noexcept                  { return load_head( memorder::acquire ).get() == nullptr; }
     inline size_type   size() const noexcept                   { return size_.load( std::memory_order_acquire); }
     inline bool        finish_waiting() const noexcept         { return finish_wating_; }
     inline void        finish_waiting( bool value ) noexcept   { finish_wating_ = value ; }
@@ -124,6 +215,10 @@ namespace ampi
   public:
     ///\brief enqueues supplyied node
     void push( node_type * user_data [[gnu::nonnull]] );
+
+    ///\brief enqueues pre linked chain with single cas
+    ///\param first newest node of chain, linked through next down to last which is oldest
+    void push( node_type * first [[gnu::nonnull]], node_type * last [[gnu::nonnull]], size_type count );
     
     ///\brief single try to dequeue entire linked list
     ///\description @{
@@ -132,56 +227,97 @@ namespace ampi
     ///@}
     ///\returns linked list of nodes with fifo order
     node_type * pull();
+
+    ///\brief detaches entire linked list in O(1) and subtracts its length from size at once
+    ///\returns iterator over nodes in fifo order, empty when queue is empty
+    afifo_drain_iterator_tmpl<user_obj_type> drain() noexcept;
     
     ///\breif waits until pop succeeds with sleeping between retrys
     ///\param sleep_millisec time in miliseconds of sleeping
     node_type * pull_wait( size_t sleep_millisec );
     static node_type * reverse( node_type * node_llist ) noexcept;
+
+  private:
+    head_type load_head( memorder order ) const noexcept
+      { return head_type{ __atomic_load_n( &head_.value, static_cast<int>(order) ) }; }
+    ///\brief links chain of count nodes in front of current head
+    void link( node_type * first, node_type * last, size_type count ) noexcept;
+    ///\returns detached list with its length
+    head_type detach() noexcept;
+    ///\brief reverses list and counts its nodes in single pass
+    static node_type * reverse( node_type * node_llist, size_type & count ) noexcept;
     };
     
   template<typename T>
-  void afifo_internal_tmpl<T>::push( node_type * next_node [[gnu::nonnull]] )
+  void afifo_internal_tmpl<T>::link( node_type * first, node_type * last, size_type count ) noexcept
     {
-    if( !finish_waiting() )
+    //atomic linked list
+    head_type last_head { load_head( memorder::relaxed ) };
+    for(;;)
       {
-      //atomic linked list
-      bool node_submitted {};
-      do
-        {
-        pointer_type last_head { head_.load( std::memory_order_relaxed ) };
-        next_node->next = last_head;
-        node_submitted = head_.compare_exchange_weak(last_head, next_node, std::memory_order_release, std::memory_order_relaxed  );
-        }
-      while(!node_submitted);
-      size_.fetch_add(1,std::memory_order_relaxed );
+      last->next = last_head.get();
+      head_type const next_head { head_type::make( first, last_head.length() + uint64_t( count ) ) };
+      if( atomic_compare_exchange( &head_.value, last_head.value, next_head.value, memorder::release, memorder::relaxed ) )
+        break;
+      last_head = load_head( memorder::relaxed );
       }
+    size_.fetch_add( count, std::memory_order_relaxed );
+    }
+
+  template<typename T>
+  void afifo_internal_tmpl<T>::push( node_type * next_node [[gnu::nonnull]] )
+    {
+    if( !finish_waiting() )
+      link( next_node, next_node, 1 );
     }
     
+  template<typename T>
+  void afifo_internal_tmpl<T>::push( node_type * first [[gnu::nonnull]], node_type * last [[gnu::nonnull]], size_type count )
+    {
+    if( !finish_waiting() )
+      link( first, last, count );
+    }
+
+  template<typename T>
+  typename afifo_internal_tmpl<T>::head_type
+  afifo_internal_tmpl<T>::detach() noexcept
+    {
+    if( load_head( memorder::relaxed ).get() == nullptr )
+      return {};
+    return head_type{ __atomic_exchange_n( &head_.value, uint64_t{}, __ATOMIC_ACQUIRE ) };
+    }
+
   template<typename T>
   typename afifo_internal_tmpl<T>::node_type * 
   afifo_internal_tmpl<T>::pull()
     {
-    pointer_type head_to_dequeue{ head_.load(std::memory_order_relaxed) };
+    head_type const head_to_dequeue{ detach() };
+    //reverse order for fifo, do any one needs here lifo order ?
+    size_type size_to_sub {};
+    node_type * result { reverse( head_to_dequeue.get(), size_to_sub ) };
+    if( size_to_sub != 0 )
+      size_.fetch_sub( size_to_sub, std::memory_order_release );
+    return result;
+    }
 
-    for (;nullptr != head_to_dequeue; //return when nothing left in queue
-            // Keep trying until Dequeue is done
-            head_to_dequeue = head_.load(std::memory_order_relaxed) )
+  template<typename T>
+  afifo_drain_iterator_tmpl<T>
+  afifo_internal_tmpl<T>::drain() noexcept
+    {
+    head_type const head_to_dequeue{ detach() };
+    if( head_to_dequeue.length() == max_counted_length )
       {
-      //if swap succeeds new head is estabilished
-      bool deque_is_done = head_.compare_exchange_weak( head_to_dequeue, pointer_type{} );
-      if( deque_is_done )
-        {
-        size_type size_to_sub {1};
-        for( auto node{ head_to_dequeue->next }; node != nullptr; node = node->next)
-           ++size_to_sub; 
-        size_.fetch_sub( 1, std::memory_order_release );
-        break;
-        }
+      // length saturated, list is counted in the reversal pass iterator would make anyway
+      size_type size_to_sub {};
+      node_type * result { reverse( head_to_dequeue.get(), size_to_sub ) };
+      size_.fetch_sub( size_to_sub, std::memory_order_release );
+      return afifo_drain_iterator_tmpl<T>{ result, true };
       }
-    //reverse order for fifo, do any one needs here lifo order ?
-    return reverse(head_to_dequeue);
+    if( head_to_dequeue.length() != 0 )
+      size_.fetch_sub( size_type( head_to_dequeue.length() ), std::memory_order_release );
+    return afifo_drain_iterator_tmpl<T>{ head_to_dequeue.get() };
     }
-    
+
   template<typename T>
   typename afifo_internal_tmpl<T>::node_type * 
   afifo_internal_tmpl<T>::reverse( node_type * llist ) noexcept
@@ -196,5 +332,19 @@ namespace ampi
       }
     return prev;
     }
-    
+
+  template<typename T>
+  typename afifo_internal_tmpl<T>::node_type *
+  afifo_internal_tmpl<T>::reverse( node_type * llist, size_type & count ) noexcept
+    {
+    node_type * prev {};
+    for( ; nullptr != llist; ++count )
+      {
+      node_type * next { llist->next };
+      llist->next = prev;
+      prev = llist;
+      llist = next;
+      }
+    return prev;
+    }
 }
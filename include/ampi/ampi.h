@@ -76,7 +76,31 @@
 #include "stack_internal.h"
 #include "afifo_internal.h"
 #include "fifo_internal.h"
+#include "arena_fifo_internal.h"
+#include "ring_internal.h"
+#include "shm_internal.h"
+#include "sharded_fifo_internal.h"
+#include "faa_fifo_internal.h"
+#include "fc_fifo_internal.h"
+#include "wf_fifo_internal.h"
+#include "mpsc_internal.h"
+#include "skiplist_pq_internal.h"
+#include "delay_queue_internal.h"
+#include "select.h"
+#include "eventfd_queue.h"
+#include "broadcast_ring_internal.h"
+#include "pipeline_ring_internal.h"
+#include "conflating_queue_internal.h"
+#include "object_pool_internal.h"
+#include "huge_page_resource.h"
+#include "numa.h"
+#include "mailbox_internal.h"
+#include "static_internal.h"
+#include "write_combiner.h"
+#include "fan_in_internal.h"
+#include "partitioned_queue.h"
 #include <memory>
+#include <memory_resource>
 
 namespace ampi
 {
@@ -87,37 +111,48 @@ namespace ampi
   //
   //----------------------------------------------------------------------------------------------------------------------
   
-  template<typename USER_OBJ_TYPE>
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
   class stack_t 
       : public stack_internal_tmpl<USER_OBJ_TYPE>
     {
   public:
     using user_obj_type =  USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
     using base_type = stack_internal_tmpl<user_obj_type>;
     using node_type = typename base_type::node_type;
+    using node_ptr_type = node_ptr_t<node_type,allocator_type>;
+
+  private:
+    allocator_type allocator_;
     
   public:
-    stack_t() : base_type()/*, free_node_to_reuse_()*/ {}
+    explicit stack_t( allocator_type const & allocator = allocator_type{} ) : base_type(), allocator_{ allocator } {}
+    ~stack_t()
+      {
+      while( node_type * node = base_type::pull() )
+        deallocate_node( allocator_, node );
+      }
     stack_t( stack_t const & ) = delete;
     stack_t & operator=( stack_t const & ) = delete;
     
     void push( user_obj_type && user_data );
     std::pair<user_obj_type, bool> pull();
+    allocator_type get_allocator() const noexcept { return allocator_; }
     };
   
-  template<typename T>
-  void stack_t<T>::push( user_obj_type && user_data )
+  template<typename T, typename A>
+  void stack_t<T,A>::push( user_obj_type && user_data )
     {
-    std::unique_ptr<node_type> next_node { std::make_unique<node_type>(std::forward<user_obj_type>(user_data)) };
+    node_ptr_type next_node { allocate_node<node_type>( allocator_, std::forward<user_obj_type>(user_data) ), { allocator_ } };
     base_type::push( next_node.get() );
     next_node.release();
     }
     
-  template<typename T>
-  std::pair<typename stack_t<T>::user_obj_type, bool>  
-  stack_t<T>::pull()
+  template<typename T, typename A>
+  std::pair<typename stack_t<T,A>::user_obj_type, bool>  
+  stack_t<T,A>::pull()
     {
-    std::unique_ptr<node_type> detached_node { base_type::pull() };
+    node_ptr_type detached_node { base_type::pull(), { allocator_ } };
     
     if( nullptr != detached_node )
       {
@@ -133,24 +168,29 @@ namespace ampi
   // aggregated pop queue
   //
   //----------------------------------------------------------------------------------------------------------------------
-  template<typename USER_OBJ_TYPE>
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
   class afifo_t ;
   
-  template<typename USER_OBJ_TYPE>
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
   class afifo_result_iterator_t :
       protected afifo_result_iterator_tmpl<USER_OBJ_TYPE>
     {
   public:
     using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
     using node_type = lifo_node_t<user_obj_type>;
     using pointer_type = node_type *;
-    using parent_type = afifo_t<user_obj_type>;
+    using parent_type = afifo_t<user_obj_type,allocator_type>;
     using base_type = afifo_result_iterator_tmpl<user_obj_type>;
+    using node_ptr_type = node_ptr_t<node_type,allocator_type>;
+
+  private:
+    allocator_type allocator_;
     
   public:
-    afifo_result_iterator_t() noexcept : base_type{} {}
-    afifo_result_iterator_t(std::unique_ptr<node_type> && llist) noexcept : 
-      base_type{llist.get()}
+    afifo_result_iterator_t() noexcept : base_type{}, allocator_{} {}
+    afifo_result_iterator_t( node_ptr_type && llist ) noexcept : 
+      base_type{llist.get()}, allocator_{ llist.get_deleter().allocator }
       { llist.release(); }
       
     afifo_result_iterator_t( afifo_result_iterator_t && rh ) noexcept ;
@@ -162,22 +202,23 @@ namespace ampi
     };
     
     
-  template<typename T>
-  afifo_result_iterator_t<T>::afifo_result_iterator_t( afifo_result_iterator_t && rh ) noexcept :
-      base_type{ std::move(rh)}
+  template<typename T, typename A>
+  afifo_result_iterator_t<T,A>::afifo_result_iterator_t( afifo_result_iterator_t && rh ) noexcept :
+      base_type{ std::move(rh)}, allocator_{ rh.allocator_ }
     {}
   
-  template<typename T>
-  void afifo_result_iterator_t<T>::swap( afifo_result_iterator_t & rh ) noexcept
+  template<typename T, typename A>
+  void afifo_result_iterator_t<T,A>::swap( afifo_result_iterator_t & rh ) noexcept
     {
     base_type::swap(rh);
+    swap_allocators( allocator_, rh.allocator_ );
     }
     
-  template<typename T>
-  std::pair<typename afifo_result_iterator_t<T>::user_obj_type, bool>
-  afifo_result_iterator_t<T>::pull()
+  template<typename T, typename A>
+  std::pair<typename afifo_result_iterator_t<T,A>::user_obj_type, bool>
+  afifo_result_iterator_t<T,A>::pull()
     {
-    std::unique_ptr<node_type> detached_node { base_type::pull() };
+    node_ptr_type detached_node { base_type::pull(), { allocator_ } };
     
     if( nullptr != detached_node )
       {
@@ -187,60 +228,209 @@ namespace ampi
     return {};
     }
     
+  ///\brief owning iterator over drained nodes in fifo order, frees nodes not pulled
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class afifo_drain_iterator_t :
+      protected afifo_drain_iterator_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using node_type = lifo_node_t<user_obj_type>;
+    using base_type = afifo_drain_iterator_tmpl<user_obj_type>;
+    using node_ptr_type = node_ptr_t<node_type,allocator_type>;
+
+  private:
+    allocator_type allocator_;
+
+  public:
+    afifo_drain_iterator_t() noexcept : base_type{}, allocator_{} {}
+    afifo_drain_iterator_t( base_type && llist, allocator_type const & allocator ) noexcept :
+        base_type{ std::move(llist) }, allocator_{ allocator } {}
+    afifo_drain_iterator_t( afifo_drain_iterator_t && rh ) noexcept : base_type{ std::move(rh) }, allocator_{ rh.allocator_ } {}
+    afifo_drain_iterator_t & operator=( afifo_drain_iterator_t && rh ) noexcept
+      {
+      base_type::swap( rh );
+      swap_allocators( allocator_, rh.allocator_ );
+      return *this;
+      }
+    ~afifo_drain_iterator_t()
+      {
+      while( node_type * node = base_type::pull() )
+        deallocate_node( allocator_, node );
+      }
+
+    using base_type::empty;
+    std::pair<user_obj_type, bool> pull()
+      {
+      node_ptr_type detached_node { base_type::pull(), { allocator_ } };
+      if( nullptr != detached_node )
+        return { std::move( detached_node->value ),  true };
+      return {};
+      }
+    };
+
   ///\brief lifo aggregated pop queue used internaly for node managment
-  template<typename USER_OBJ_TYPE>
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR>
   class afifo_t 
       : public afifo_internal_tmpl<USER_OBJ_TYPE>
     {
   public:
     using user_obj_type =  USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
     using base_type = afifo_internal_tmpl<user_obj_type>;
     using node_type = typename base_type::node_type;
-    using pop_iterator_type = afifo_result_iterator_t<user_obj_type>;
+    using node_ptr_type = node_ptr_t<node_type,allocator_type>;
+    using pop_iterator_type = afifo_result_iterator_t<user_obj_type,allocator_type>;
+    using drain_iterator_type = afifo_drain_iterator_t<user_obj_type,allocator_type>;
+
+  private:
+    allocator_type allocator_;
     
   public:
-    afifo_t() : base_type()/*, free_node_to_reuse_()*/ {}
+    explicit afifo_t( allocator_type const & allocator = allocator_type{} ) : base_type(), allocator_{ allocator } {}
+    ~afifo_t() { drain(); }
     afifo_t( afifo_t const & ) = delete;
     afifo_t & operator=( afifo_t const & ) = delete;
     
     void push( user_obj_type && user_data );
+
+    ///\brief moves elements of range into queue publishing them as one pre linked chain
+    /// when allocation throws nothing is published and values are moved back to range
+    template<typename iterator_type>
+    void push_range( iterator_type first, iterator_type last );
+
     std::pair<pop_iterator_type, bool> pull();
+
+    ///\brief detaches all elements in O(1), iterator yields them in push order
+    drain_iterator_type drain() noexcept { return drain_iterator_type{ base_type::drain(), allocator_ }; }
+    allocator_type get_allocator() const noexcept { return allocator_; }
     };
     
-  template<typename T>
-  void afifo_t<T>::push( user_obj_type && user_data )
+  template<typename T, typename A>
+  void afifo_t<T,A>::push( user_obj_type && user_data )
     {
-    std::unique_ptr<node_type> next_node { std::make_unique<node_type>(std::forward<user_obj_type>(user_data)) };
+    node_ptr_type next_node { allocate_node<node_type>( allocator_, std::forward<user_obj_type>(user_data) ), { allocator_ } };
     base_type::push( next_node.get() );
     next_node.release();
     }
   
-  template<typename T>
-  std::pair<typename afifo_t<T>::pop_iterator_type, bool>
-  afifo_t<T>::pull()
+  template<typename T, typename A>
+  template<typename iterator_type>
+  void afifo_t<T,A>::push_range( iterator_type first, iterator_type last )
+    {
+    // chain is linked newest first as afifo expects
+    node_type * newest {};
+    node_type * oldest {};
+    typename base_type::size_type count {};
+    iterator_type const range_first { first };
+    try
+      {
+      for( ; first != last; ++first, ++count )
+        {
+        node_type * node { allocate_node<node_type>( allocator_, std::move( *first ) ) };
+        node->next = newest;
+        newest = node;
+        if( oldest == nullptr )
+          oldest = node;
+        }
+      }
+    catch(...)
+      {
+      // oldest first order matches range
+      iterator_type source { range_first };
+      for( node_type * node { base_type::reverse( newest ) }; node != nullptr; ++source )
+        {
+        node_type * next { node->next };
+        *source = std::move( node->value );
+        deallocate_node( allocator_, node );
+        node = next;
+        }
+      throw;
+      }
+    if( count != 0 )
+      base_type::push( newest, oldest, count );
+    }
+
+  template<typename T, typename A>
+  std::pair<typename afifo_t<T,A>::pop_iterator_type, bool>
+  afifo_t<T,A>::pull()
     {
-    std::unique_ptr<node_type> node_list { base_type::pull() };
+    node_ptr_type node_list { base_type::pull(), { allocator_ } };
     bool success = static_cast<bool>(node_list);
     return {pop_iterator_type{ std::move(node_list) }, success };
     }
 
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // mpsc_t
+  // multi producer single consumer fifo for mailboxes, producer cost equal to afifo_t, consumer pulls single elements
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class mpsc_t
+      : public mpsc_internal_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using base_type = mpsc_internal_tmpl<user_obj_type>;
+    using node_type = typename base_type::node_type;
+    using node_ptr_type = node_ptr_t<node_type,allocator_type>;
+
+  private:
+    allocator_type allocator_;
+
+  public:
+    explicit mpsc_t( allocator_type const & allocator = allocator_type{} ) : base_type(), allocator_{ allocator } {}
+    ~mpsc_t()
+      {
+      while( node_type * node = base_type::pull() )
+        deallocate_node( allocator_, node );
+      }
+    mpsc_t( mpsc_t const & ) = delete;
+    mpsc_t & operator=( mpsc_t const & ) = delete;
+
+    allocator_type get_allocator() const noexcept { return allocator_; }
+
+    void push( user_obj_type && user_data )
+      {
+      node_ptr_type next_node { allocate_node<node_type>( allocator_, std::forward<user_obj_type>(user_data) ), { allocator_ } };
+      base_type::push( next_node.get() );
+      next_node.release();
+      }
+
+    ///\brief consumer side only
+    std::pair<user_obj_type, bool> pull()
+      {
+      node_ptr_type detached_node { base_type::pull(), { allocator_ } };
+      if( nullptr != detached_node )
+        return { std::move( detached_node->value ),  true };
+      return {};
+      }
+    };
+
   //----------------------------------------------------------------------------------------------------------------------
   //
   // fifo_queue_t
   //
   //----------------------------------------------------------------------------------------------------------------------
   
-  template<typename USER_OBJ_TYPE>
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
   class fifo_queue_t
-    : public fifo_queue_internal_tmpl<queue_envelope_t<USER_OBJ_TYPE>>
+    : public fifo_queue_internal_tmpl<queue_envelope_t<USER_OBJ_TYPE>,ALLOCATOR>
   {
   public:
     typedef USER_OBJ_TYPE user_obj_type;
+    typedef ALLOCATOR allocator_type;
     typedef queue_envelope_t<user_obj_type> envelope_type;
-    typedef fifo_queue_internal_tmpl<envelope_type> base_type;
+    typedef fifo_queue_internal_tmpl<envelope_type,allocator_type> base_type;
+    typedef node_ptr_t<envelope_type,allocator_type> envelope_ptr_type;
 
   public:
-    fifo_queue_t() : base_type(){}
+    explicit fifo_queue_t( allocator_type const & allocator = allocator_type{} ) : base_type( allocator ){}
+    explicit fifo_queue_t( fifo_cache_config_t config, allocator_type const & allocator = allocator_type{} ) :
+        base_type( allocator, config ){}
     ~fifo_queue_t()
       {
       try
@@ -252,7 +442,7 @@ namespace ampi
           {
           envelope_type * any_data = base_type::pull();
           if( any_data )
-            delete any_data;
+            deallocate_node( this->get_allocator(), any_data );
           else
             break;
           }
@@ -261,12 +451,46 @@ namespace ampi
       catch(...)
         {}
       }
-    void push( user_obj_type const & user_data ) {  base_type::push( new envelope_type( user_data ) ); }
-    void push( user_obj_type && user_data ) { base_type::push( new envelope_type( std::move(user_data) ) ); }
+    void push( user_obj_type const & user_data ) {  push_envelope( allocate_node<envelope_type>( this->get_allocator(), user_data ) ); }
+    void push( user_obj_type && user_data ) { push_envelope( allocate_node<envelope_type>( this->get_allocator(), std::move(user_data) ) ); }
+
+    ///\brief moves elements of range into queue, every chunk of elements is linked with single cas
+    /// when allocation throws chunks before failing one stay published and values of failing chunk are moved back
+    template<typename iterator_type>
+    void push_range( iterator_type first, iterator_type last )
+      {
+      constexpr typename base_type::size_type chunk_size { 64 };
+      envelope_type * chunk[chunk_size];
+      typename base_type::size_type count {};
+      iterator_type chunk_first { first };
+      try
+        {
+        for( ; first != last; ++first )
+          {
+          chunk[count++] = allocate_node<envelope_type>( this->get_allocator(), std::move( *first ) );
+          if( count == chunk_size )
+            {
+            base_type::push( chunk, count );
+            count = 0;
+            chunk_first = std::next( first );
+            }
+          }
+        base_type::push( chunk, count );
+        }
+      catch(...)
+        {
+        for( typename base_type::size_type index{}; index != count; ++index, ++chunk_first )
+          {
+          *chunk_first = std::move( chunk[index]->value );
+          deallocate_node( this->get_allocator(), chunk[index] );
+          }
+        throw;
+        }
+      }
     
     std::pair<user_obj_type,bool> pull()
       {
-      std::unique_ptr<envelope_type> envelope{ base_type::pull() };
+      envelope_ptr_type envelope{ base_type::pull(), { this->get_allocator() } };
       if( envelope )  
         return { std::move(envelope->value), true };
       return {};
@@ -274,13 +498,677 @@ namespace ampi
       
      std::pair<user_obj_type,bool> pull_wait( size_t sleep_tm )
       {
-      std::unique_ptr<envelope_type> envelope( base_type::pull_wait( sleep_tm ) );
+      envelope_ptr_type envelope( base_type::pull_wait( sleep_tm ), { this->get_allocator() } );
       if( envelope )  
         return { std::move(envelope->value), true };
       return {};
       }
+
+  private:
+    void push_envelope( envelope_type * envelope )
+      {
+      envelope_ptr_type guard{ envelope, { this->get_allocator() } };
+      base_type::push( guard.get() );
+      guard.release();
+      }
     };
 
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // sharded_fifo_t
+  // relaxed fifo for many core scaling, see sharded_fifo_internal.h for ordering guarantees
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class sharded_fifo_t
+    : public sharded_fifo_internal_tmpl<queue_envelope_t<USER_OBJ_TYPE>,ALLOCATOR>
+  {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using envelope_type = queue_envelope_t<user_obj_type>;
+    using base_type = sharded_fifo_internal_tmpl<envelope_type,allocator_type>;
+    using envelope_ptr_type = node_ptr_t<envelope_type,allocator_type>;
+
+  public:
+    explicit sharded_fifo_t( uint32_t shard_count = 0, allocator_type const & allocator = allocator_type{} ) :
+        base_type( shard_count, allocator ){}
+    ~sharded_fifo_t()
+      {
+      for(;;)
+        {
+        envelope_type * any_data = base_type::pull();
+        if( any_data )
+          deallocate_node( this->get_allocator(), any_data );
+        else
+          break;
+        }
+      }
+    void push( user_obj_type const & user_data ) {  push_envelope( allocate_node<envelope_type>( this->get_allocator(), user_data ) ); }
+    void push( user_obj_type && user_data ) { push_envelope( allocate_node<envelope_type>( this->get_allocator(), std::move(user_data) ) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      envelope_ptr_type envelope{ base_type::pull(), { this->get_allocator() } };
+      if( envelope )
+        return { std::move(envelope->value), true };
+      return {};
+      }
+
+  private:
+    void push_envelope( envelope_type * envelope )
+      {
+      envelope_ptr_type guard{ envelope, { this->get_allocator() } };
+      base_type::push( guard.get() );
+      guard.release();
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // faa_fifo_t
+  // unbounded mpmc fifo of array segments with fetch_add slot claiming
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class faa_fifo_t
+    : public faa_fifo_internal_tmpl<queue_envelope_t<USER_OBJ_TYPE>,ALLOCATOR>
+  {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using envelope_type = queue_envelope_t<user_obj_type>;
+    using base_type = faa_fifo_internal_tmpl<envelope_type,allocator_type>;
+    using envelope_ptr_type = node_ptr_t<envelope_type,allocator_type>;
+
+  public:
+    explicit faa_fifo_t( reclamation_domain_t & domain = default_reclamation_domain(),
+                         allocator_type const & allocator = allocator_type{} ) :
+        base_type( domain, allocator ){}
+    explicit faa_fifo_t( allocator_type const & allocator ) : base_type( default_reclamation_domain(), allocator ){}
+    ~faa_fifo_t()
+      {
+      for(;;)
+        {
+        envelope_type * any_data = base_type::pull();
+        if( any_data )
+          deallocate_node( this->get_allocator(), any_data );
+        else
+          break;
+        }
+      }
+    void push( user_obj_type const & user_data ) {  push_envelope( allocate_node<envelope_type>( this->get_allocator(), user_data ) ); }
+    void push( user_obj_type && user_data ) { push_envelope( allocate_node<envelope_type>( this->get_allocator(), std::move(user_data) ) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      envelope_ptr_type envelope{ base_type::pull(), { this->get_allocator() } };
+      if( envelope )
+        return { std::move(envelope->value), true };
+      return {};
+      }
+
+  private:
+    void push_envelope( envelope_type * envelope )
+      {
+      envelope_ptr_type guard{ envelope, { this->get_allocator() } };
+      base_type::push( guard.get() );
+      guard.release();
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // arena_fifo_t
+  // fifo with fixed capacity node slab, 32bit indexes instead of pointers
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class arena_fifo_t
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = arena_fifo_internal_tmpl<user_obj_type>;
+    using index_type = typename base_type::index_type;
+    using size_type = typename base_type::size_type;
+
+  private:
+    slab_ptr_t<base_type> data_;
+
+  public:
+    explicit arena_fifo_t( index_type capacity ) : data_{ make_slab<base_type>( capacity ) } {}
+    arena_fifo_t( arena_fifo_t const & ) = delete;
+    arena_fifo_t & operator=( arena_fifo_t const & ) = delete;
+
+    bool        empty() const noexcept           { return data_->empty(); }
+    size_type   size() const  noexcept           { return data_->size(); }
+    index_type  capacity() const noexcept        { return data_->capacity(); }
+
+    ///\returns false when arena has no free node
+    bool push( user_obj_type const & user_data ) noexcept { return data_->push( user_data ); }
+
+    std::pair<user_obj_type,bool> pull() noexcept
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = data_->pull( result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // ring_t
+  // bounded mpmc ring
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class ring_t
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = ring_internal_tmpl<user_obj_type>;
+    using size_type = typename base_type::size_type;
+
+  private:
+    slab_ptr_t<base_type> data_;
+
+  public:
+    ///\param capacity is rounded up to power of 2
+    explicit ring_t( uint64_t capacity ) : data_{ make_slab<base_type>( capacity ) } {}
+    ring_t( ring_t const & ) = delete;
+    ring_t & operator=( ring_t const & ) = delete;
+
+    bool        empty() const noexcept           { return data_->empty(); }
+    size_type   size() const  noexcept           { return data_->size(); }
+    uint64_t    capacity() const noexcept        { return data_->capacity(); }
+
+    ///\returns false when ring is full
+    bool push( user_obj_type const & user_data ) { return data_->push( user_data ); }
+    bool push( user_obj_type && user_data ) { return data_->push( std::move(user_data) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = data_->pull( result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // fc_fifo_t
+  // flat combining fifo for oversubscribed workloads
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class fc_fifo_t
+      : public fc_fifo_internal_tmpl<USER_OBJ_TYPE,ALLOCATOR>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = fc_fifo_internal_tmpl<user_obj_type,ALLOCATOR>;
+    using allocator_type = typename base_type::allocator_type;
+
+  public:
+    explicit fc_fifo_t( uint32_t slot_count = 0, allocator_type const & allocator = allocator_type{} ) :
+        base_type( slot_count, allocator ) {}
+
+    void push( user_obj_type const & user_data ) { base_type::push( user_obj_type{ user_data } ); }
+    void push( user_obj_type && user_data ) { base_type::push( std::move(user_data) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // wf_fifo_t
+  // wait-free fifo with bounded number of steps per operation
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class wf_fifo_t
+      : public wf_fifo_internal_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = wf_fifo_internal_tmpl<user_obj_type>;
+    using index_type = typename base_type::index_type;
+
+  public:
+    explicit wf_fifo_t( index_type capacity, uint32_t thread_count = 0 ) : base_type( capacity, thread_count ) {}
+
+    ///\returns false when there is no free node
+    bool push( user_obj_type const & user_data ) { return base_type::push( user_obj_type{ user_data } ); }
+    bool push( user_obj_type && user_data ) { return base_type::push( std::move(user_data) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // priority_queue_t
+  // lock free skiplist priority queue, pull_min returns element with lowest priority
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename PRIORITY_TYPE, typename USER_OBJ_TYPE, typename COMPARE = std::less<PRIORITY_TYPE>,
+           typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class priority_queue_t
+      : public skiplist_pq_internal_tmpl<PRIORITY_TYPE,USER_OBJ_TYPE,COMPARE,ALLOCATOR>
+    {
+  public:
+    using priority_type = PRIORITY_TYPE;
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using base_type = skiplist_pq_internal_tmpl<priority_type,user_obj_type,COMPARE,allocator_type>;
+
+  public:
+    explicit priority_queue_t( reclamation_domain_t & domain = default_reclamation_domain(),
+                               uint32_t bound_offset = base_type::default_bound_offset,
+                               allocator_type const & allocator = allocator_type{} ) :
+        base_type( domain, bound_offset, allocator )
+      {}
+    explicit priority_queue_t( allocator_type const & allocator ) :
+        base_type( default_reclamation_domain(), base_type::default_bound_offset, allocator )
+      {}
+
+    void push( priority_type const & priority, user_obj_type const & user_data ) { base_type::push( priority, user_obj_type{ user_data } ); }
+    void push( priority_type const & priority, user_obj_type && user_data ) { base_type::push( priority, std::move(user_data) ); }
+
+    using base_type::pull_min;
+    std::pair<user_obj_type,bool> pull_min()
+      {
+      std::pair<user_obj_type,bool> result{};
+      priority_type priority;
+      result.second = base_type::pull_min( priority, result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // delay_queue_t
+  // elements become available to consumers when their deadline passes
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class delay_queue_t
+      : public delay_queue_internal_tmpl<USER_OBJ_TYPE,ALLOCATOR>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using base_type = delay_queue_internal_tmpl<user_obj_type,allocator_type>;
+    using clock_type = typename base_type::clock_type;
+    using time_point = typename base_type::time_point;
+    using duration = typename base_type::duration;
+
+  public:
+    explicit delay_queue_t( duration tick = std::chrono::milliseconds{1}, allocator_type const & allocator = allocator_type{} ) :
+        base_type( tick, allocator ) {}
+
+    void push( time_point deadline, user_obj_type const & user_data ) { base_type::push( deadline, user_obj_type{ user_data } ); }
+    void push( time_point deadline, user_obj_type && user_data ) { base_type::push( deadline, std::move(user_data) ); }
+
+    template<typename value_type>
+    void push_after( duration delay, value_type && user_data ) { push( clock_type::now() + delay, std::forward<value_type>(user_data) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( result.first );
+      return result;
+      }
+
+    std::pair<user_obj_type,bool> pull_wait( long timeout_ms = -1 )
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull_wait( result.first, timeout_ms );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // broadcast_ring_t
+  // every subscribed consumer reads every message in place
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, producer_mode MODE = producer_mode::single>
+  class broadcast_ring_t
+      : public broadcast_ring_internal_tmpl<USER_OBJ_TYPE,MODE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = broadcast_ring_internal_tmpl<user_obj_type,MODE>;
+
+  public:
+    broadcast_ring_t( uint64_t capacity, uint32_t max_consumers ) : base_type( capacity, max_consumers ) {}
+
+    using base_type::pull;
+    std::pair<user_obj_type,bool> pull( int consumer )
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( consumer, result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // pipeline_ring_t
+  // multi stage processing in place over single ring with sequence barriers
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  using pipeline_ring_t = pipeline_ring_internal_tmpl<USER_OBJ_TYPE>;
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // conflating_queue_t
+  // last value queue, consumer gets only latest value published for each key
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename KEY_TYPE, typename USER_OBJ_TYPE, typename HASH = std::hash<KEY_TYPE>,
+           typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class conflating_queue_t
+      : public conflating_queue_internal_tmpl<KEY_TYPE,USER_OBJ_TYPE,HASH,ALLOCATOR>
+    {
+  public:
+    using key_type = KEY_TYPE;
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using base_type = conflating_queue_internal_tmpl<key_type,user_obj_type,HASH,allocator_type>;
+
+  public:
+    explicit conflating_queue_t( uint32_t max_keys, HASH const & hash = HASH{}, allocator_type const & allocator = allocator_type{} ) :
+        base_type( max_keys, hash, allocator ) {}
+
+    using base_type::pull;
+    ///\returns key and its latest value, second is false when no key has pending value
+    std::pair<std::pair<key_type,user_obj_type>,bool> pull()
+      {
+      std::pair<std::pair<key_type,user_obj_type>,bool> result{};
+      result.second = base_type::pull( result.first.first, result.first.second );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // object_pool_t
+  // recycles objects through per thread caches, handles return objects to pool on destruction
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class object_pool_t;
+
+  template<typename USER_OBJ_TYPE>
+  class object_pool_handle_t
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using pool_type = object_pool_internal_tmpl<user_obj_type>;
+    using node_type = typename pool_type::node_type;
+
+  private:
+    pool_type * pool_;
+    node_type * node_;
+
+  public:
+    object_pool_handle_t() noexcept : pool_{}, node_{} {}
+    object_pool_handle_t( pool_type & pool, node_type * node ) noexcept : pool_{ &pool }, node_{ node } {}
+    object_pool_handle_t( object_pool_handle_t && other ) noexcept : pool_{ other.pool_ }, node_{ other.node_ }
+      { other.node_ = nullptr; }
+    object_pool_handle_t & operator=( object_pool_handle_t && other ) noexcept
+      {
+      if( this != &other )
+        {
+        reset();
+        pool_ = other.pool_;
+        node_ = other.node_;
+        other.node_ = nullptr;
+        }
+      return *this;
+      }
+    ~object_pool_handle_t() { reset(); }
+
+    explicit operator bool() const noexcept        { return node_ != nullptr; }
+    user_obj_type * get() const noexcept           { return node_ != nullptr ? &node_->value : nullptr; }
+    user_obj_type & operator*() const noexcept     { return node_->value; }
+    user_obj_type * operator->() const noexcept    { return &node_->value; }
+
+    ///\brief returns object to pool
+    void reset() noexcept
+      {
+      if( node_ != nullptr )
+        pool_->release( node_ );
+      node_ = nullptr;
+      }
+    };
+
+  template<typename USER_OBJ_TYPE>
+  class object_pool_t
+      : public object_pool_internal_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = object_pool_internal_tmpl<user_obj_type>;
+    using handle_type = object_pool_handle_t<user_obj_type>;
+
+  public:
+    explicit object_pool_t( uint32_t batch_size = 32, uint32_t cache_count = 16 ) : base_type( batch_size, cache_count ) {}
+
+    ///\returns handle owning recycled object or new object constructed from args when pool is empty
+    template<typename ... args_type>
+    handle_type acquire( args_type && ... args )
+      { return handle_type{ *this, base_type::acquire( std::forward<args_type>(args)... ) }; }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // mailbox_t, mpsc_mailbox_t
+  // per session mailboxes, two words when empty and no allocation before first push
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class mailbox_t
+      : public mailbox_internal_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = mailbox_internal_tmpl<user_obj_type>;
+
+  public:
+    mailbox_t() noexcept : base_type() {}
+
+    using base_type::pull;
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( result.first );
+      return result;
+      }
+    };
+
+  template<typename USER_OBJ_TYPE>
+  class mpsc_mailbox_t
+      : public mpsc_mailbox_internal_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = mpsc_mailbox_internal_tmpl<user_obj_type>;
+    using node_type = typename base_type::node_type;
+
+  public:
+    mpsc_mailbox_t() noexcept : base_type() {}
+    ~mpsc_mailbox_t()
+      {
+      while( node_type * node = base_type::pull() )
+        delete node;
+      }
+
+    void push( user_obj_type && user_data ) { base_type::push( new node_type( std::move(user_data) ) ); }
+    void push( user_obj_type const & user_data ) { push( user_obj_type{ user_data } ); }
+
+    ///\brief consumer side only
+    std::pair<user_obj_type, bool> pull()
+      {
+      std::unique_ptr<node_type> detached_node { base_type::pull() };
+      if( nullptr != detached_node )
+        return { std::move( detached_node->value ),  true };
+      return {};
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // static_stack_t, static_fifo_t, static_mpsc_t
+  // compile time capacity, storage inside object, never allocate, constant initialized in static storage
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename BASE_TYPE>
+  class static_container_tmpl
+      : public BASE_TYPE
+    {
+  public:
+    using base_type = BASE_TYPE;
+    using user_obj_type = typename base_type::user_obj_type;
+
+  public:
+    constexpr static_container_tmpl() noexcept = default;
+
+    using base_type::pull;
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( result.first );
+      return result;
+      }
+    };
+
+  template<typename USER_OBJ_TYPE, uint32_t CAPACITY>
+  using static_stack_t = static_container_tmpl<static_stack_internal_tmpl<USER_OBJ_TYPE,CAPACITY>>;
+
+  template<typename USER_OBJ_TYPE, uint32_t CAPACITY>
+  using static_fifo_t = static_container_tmpl<static_ring_internal_tmpl<USER_OBJ_TYPE,CAPACITY,false>>;
+
+  template<typename USER_OBJ_TYPE, uint32_t CAPACITY>
+  using static_mpsc_t = static_container_tmpl<static_ring_internal_tmpl<USER_OBJ_TYPE,CAPACITY,true>>;
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // fan_in_queue_t
+  // mpsc of per producer spsc lanes, producers never contend with each other
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class fan_in_queue_t
+      : public fan_in_queue_internal_tmpl<USER_OBJ_TYPE>
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using base_type = fan_in_queue_internal_tmpl<user_obj_type>;
+
+  public:
+    fan_in_queue_t( uint64_t lane_capacity, uint32_t max_producers, bool timestamps = false ) :
+        base_type( lane_capacity, max_producers, timestamps ) {}
+
+    using base_type::pull;
+    std::pair<user_obj_type,bool> pull()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull( result.first );
+      return result;
+      }
+
+    using base_type::pull_ordered;
+    std::pair<user_obj_type,bool> pull_ordered()
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = base_type::pull_ordered( result.first );
+      return result;
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // shm_fifo_t, shm_ring_t
+  // interprocess queues in posix shared memory or memfd mapping
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  using shm_fifo_t = shm_queue_tmpl<arena_fifo_internal_tmpl<USER_OBJ_TYPE>>;
+
+  template<typename USER_OBJ_TYPE>
+  using shm_ring_t = shm_queue_tmpl<ring_internal_tmpl<USER_OBJ_TYPE>>;
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // pmr
+  // containers allocating nodes from std::pmr::memory_resource
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  namespace pmr
+    {
+    template<typename USER_OBJ_TYPE>
+    using stack_t = ampi::stack_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using afifo_t = ampi::afifo_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using mpsc_t = ampi::mpsc_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using fifo_queue_t = ampi::fifo_queue_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using sharded_fifo_t = ampi::sharded_fifo_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using faa_fifo_t = ampi::faa_fifo_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using fc_fifo_t = ampi::fc_fifo_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename PRIORITY_TYPE, typename USER_OBJ_TYPE, typename COMPARE = std::less<PRIORITY_TYPE>>
+    using priority_queue_t = ampi::priority_queue_t<PRIORITY_TYPE,USER_OBJ_TYPE,COMPARE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename USER_OBJ_TYPE>
+    using delay_queue_t = ampi::delay_queue_t<USER_OBJ_TYPE,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+
+    template<typename KEY_TYPE, typename USER_OBJ_TYPE, typename HASH = std::hash<KEY_TYPE>>
+    using conflating_queue_t = ampi::conflating_queue_t<KEY_TYPE,USER_OBJ_TYPE,HASH,std::pmr::polymorphic_allocator<USER_OBJ_TYPE>>;
+    }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // numa_fifo_t
+  // socket local fifo shards with nodes from node local huge page regions
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  using numa_fifo_t = numa_sharded_queue_t<pmr::fifo_queue_t<USER_OBJ_TYPE>>;
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // partitioned_queue_t
+  // fifo partitions selected by key hash, per key order with parallel consumers
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename KEY_TYPE, typename USER_OBJ_TYPE, typename HASH = std::hash<KEY_TYPE>>
+  using partitioned_queue_t = partitioned_queue_tmpl<KEY_TYPE, fifo_queue_t<USER_OBJ_TYPE>, HASH>;
+
   //----------------------------------------------------------------------------------------------------------------------
   //
   // common functional access methods
@@ -0,0 +1,255 @@
+// MIT License
+//
+// Copyright (c) 2019 Artur Bac
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// Michael L. Scott fifo over contiguous node slab
+// nodes are never returned to the system while queue exists so the algorithm requirement of type-preserving allocator
+// is met without delayed reclamation, links are 32bit indexes with 32bit aba tags in single 64bit cas word.
+// There are no pointers inside the arena so entire arena may be relocated (or mapped at different address) when queue is
+// not in use.
+
+#pragma once
+
+#include "common_utils.h"
+#include <cstring>
+#include <type_traits>
+#include <limits>
+#include <new>
+
+namespace ampi
+{
+  template<typename USER_OBJ_TYPE>
+  struct arena_fifo_node_t
+    {
+    using user_obj_type = USER_OBJ_TYPE;
+
+    std::atomic<index_pointer_t> next;
+    user_obj_type                value;
+
+    arena_fifo_node_t() noexcept : next{}, value{} {}
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // arena_fifo_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief fifo queue with nodes in slab following queue header
+  ///\description @{
+  /// object must be constructed with placement new in memory of storage_size(capacity) bytes aligned to cache line,
+  /// node slab is placed right after header
+  ///@}
+  template<typename USER_OBJ_TYPE>
+  class alignas(64) arena_fifo_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using node_type = arena_fifo_node_t<user_obj_type>;
+    using pointer_type = index_pointer_t;
+    using index_type = index_pointer_t::index_type;
+    using size_type = long;
+
+    static_assert( std::is_trivially_copyable<user_obj_type>::value, "arena fifo stores values in relocatable slab, only trivially copyable types are supported" );
+    static constexpr std::size_t cache_line_size = 64;
+    ///\brief largest capacity, one node is dummy and null_index is reserved
+    static constexpr index_type max_capacity = std::numeric_limits<index_type>::max() - 2;
+
+  private:
+    alignas(cache_line_size) std::atomic<pointer_type> head_;
+    alignas(cache_line_size) std::atomic<pointer_type> tail_;
+    alignas(cache_line_size) std::atomic<pointer_type> free_;
+    std::atomic<size_type>      size_;
+    index_type                  capacity_;
+
+  public:
+    bool        empty() const noexcept           { return size_.load(std::memory_order_acquire) == 0; }
+    size_type   size() const  noexcept           { return size_.load(std::memory_order_acquire); }
+    index_type  capacity() const noexcept        { return capacity_; }
+
+    ///\returns number of bytes required for queue header and node slab
+    static constexpr std::size_t storage_size( index_type capacity ) noexcept
+      { return sizeof(arena_fifo_internal_tmpl) + (std::size_t(capacity) + 1) * sizeof(node_type); }
+
+  public:
+    explicit arena_fifo_internal_tmpl( index_type capacity ) noexcept;
+    ~arena_fifo_internal_tmpl();
+    arena_fifo_internal_tmpl( arena_fifo_internal_tmpl const & ) = delete;
+    arena_fifo_internal_tmpl & operator=( arena_fifo_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief enqueues copy of user_data
+    ///\returns false when there is no free node in arena
+    bool push( user_obj_type const & user_data ) noexcept;
+
+    ///\brief single try to dequeue element
+    ///\returns false when queue is empty
+    bool pull( user_obj_type & user_data ) noexcept;
+
+  private:
+    node_type & node_at( index_type index ) noexcept
+      { return reinterpret_cast<node_type *>( this + 1 )[index - 1]; }
+    index_type alloc() noexcept;
+    void free_node( index_type index ) noexcept;
+    };
+
+  template<typename T>
+  arena_fifo_internal_tmpl<T>::arena_fifo_internal_tmpl( index_type capacity ) noexcept :
+      head_{},
+      tail_{},
+      free_{},
+      size_{},
+      capacity_{ capacity }
+    {
+    assert( capacity <= max_capacity );
+    static_assert( sizeof(arena_fifo_internal_tmpl) % alignof(node_type) == 0, "node slab must be aligned" );
+    index_type const node_count { capacity + 1 };
+    for( index_type index{1}; index <= node_count; ++index )
+      new (&node_at(index)) node_type();
+
+    // first node is dummy, Both Head and Tail point to it
+    head_.store( pointer_type{ 1, 0 }, std::memory_order_relaxed );
+    tail_.store( pointer_type{ 1, 0 }, std::memory_order_relaxed );
+    // remaining nodes are linked into free list
+    for( index_type index{2}; index <= node_count; ++index )
+      node_at(index).next.store( pointer_type{ index != node_count ? index + 1 : pointer_type::null_index, 0 }, std::memory_order_relaxed );
+    free_.store( pointer_type{ node_count > 1 ? 2u : pointer_type::null_index, 0 }, std::memory_order_release );
+    }
+
+  template<typename T>
+  arena_fifo_internal_tmpl<T>::~arena_fifo_internal_tmpl()
+    {
+    index_type const node_count { capacity_ + 1 };
+    for( index_type index{1}; index <= node_count; ++index )
+      node_at(index).~node_type();
+    }
+
+  template<typename T>
+  typename arena_fifo_internal_tmpl<T>::index_type
+  arena_fifo_internal_tmpl<T>::alloc() noexcept
+    {
+    pointer_type head { free_.load( std::memory_order_acquire ) };
+    while( head )
+      {
+      // node may be already reused by other thread, tag of free_ invalidates cas then
+      pointer_type next { node_at( head.index() ).next.load( std::memory_order_relaxed ) };
+      if( free_.compare_exchange_weak( head, pointer_type{ next.index(), head.tag() + 1 }, std::memory_order_acquire, std::memory_order_acquire ) )
+        return head.index();
+      }
+    return pointer_type::null_index;
+    }
+
+  template<typename T>
+  void arena_fifo_internal_tmpl<T>::free_node( index_type index ) noexcept
+    {
+    node_type & node { node_at( index ) };
+    pointer_type head { free_.load( std::memory_order_relaxed ) };
+    pointer_type next { node.next.load( std::memory_order_relaxed ) };
+    do
+      {
+      // keep tag of node monotonic so stale cas on next of reused node fails
+      node.next.store( pointer_type{ head.index(), next.tag() + 1 }, std::memory_order_relaxed );
+      }
+    while( !free_.compare_exchange_weak( head, pointer_type{ index, head.tag() + 1 }, std::memory_order_release, std::memory_order_relaxed ) );
+    }
+
+  template<typename T>
+  bool arena_fifo_internal_tmpl<T>::push( user_obj_type const & user_data ) noexcept
+    {
+    // Allocate a new node from the free list
+    index_type const index { alloc() };
+    if( index == pointer_type::null_index )
+      return false;
+
+    node_type & node { node_at( index ) };
+    std::memcpy( &node.value, &user_data, sizeof(user_obj_type) );
+    // Set next pointer of node to NULL
+    pointer_type const node_next { node.next.load( std::memory_order_relaxed ) };
+    node.next.store( pointer_type{ pointer_type::null_index, node_next.tag() + 1 }, std::memory_order_relaxed );
+
+    pointer_type tail_local;
+    // Keep trying until Enqueue is done
+    for(;;)
+      {
+      // Read Tail.ptr and Tail.count together
+      tail_local = tail_.load( std::memory_order_acquire );
+      // Read next ptr and count fields together
+      pointer_type next { node_at( tail_local.index() ).next.load( std::memory_order_acquire ) };
+      // Are tail_local and next consistent?
+      if( tail_local == tail_.load( std::memory_order_acquire ) )
+        {
+        // Was Tail pointing to the last node?
+        if( !next )
+          {
+          // Try to link node at the end of the linked list
+          if( node_at( tail_local.index() ).next.compare_exchange_strong( next, pointer_type{ index, next.tag() + 1 }, std::memory_order_seq_cst ) )
+            break;
+          }
+        else
+          // Tail was not pointing to the last node, try to swing Tail to the next node
+          tail_.compare_exchange_strong( tail_local, pointer_type{ next.index(), tail_local.tag() + 1 }, std::memory_order_seq_cst );
+        }
+      }
+    // Enqueue is done.  Try to swing Tail to the inserted node
+    tail_.compare_exchange_strong( tail_local, pointer_type{ index, tail_local.tag() + 1 }, std::memory_order_seq_cst );
+    size_.fetch_add( size_type{1}, std::memory_order_release );
+    return true;
+    }
+
+  template<typename T>
+  bool arena_fifo_internal_tmpl<T>::pull( user_obj_type & user_data ) noexcept
+    {
+    pointer_type head;
+    // Keep trying until Dequeue is done
+    for(;;)
+      {
+      head = head_.load( std::memory_order_acquire );
+      pointer_type tail { tail_.load( std::memory_order_acquire ) };
+      // node is never freed, at most reused so reading is safe
+      pointer_type next { node_at( head.index() ).next.load( std::memory_order_acquire ) };
+      // Are head, tail, and next consistent?
+      if( head == head_.load( std::memory_order_acquire ) )
+        {
+        // Is queue empty or Tail falling behind?
+        if( head.index() == tail.index() )
+          {
+          if( !next )
+            return false;
+          // Tail is falling behind.  Try to advance it
+          tail_.compare_exchange_strong( tail, pointer_type{ next.index(), tail.tag() + 1 }, std::memory_order_seq_cst );
+          }
+        else if( next )
+          {
+          // Read value before CAS, otherwise another dequeue might reuse the next node
+          std::memcpy( &user_data, &node_at( next.index() ).value, sizeof(user_obj_type) );
+          // Try to swing Head to the next node
+          if( head_.compare_exchange_strong( head, pointer_type{ next.index(), head.tag() + 1 }, std::memory_order_seq_cst ) )
+            break;
+          }
+        }
+      }
+    // It is safe now to reuse the old dummy node
+    free_node( head.index() );
+    size_.fetch_sub( size_type{1}, std::memory_order_release );
+    return true;
+    }
+}
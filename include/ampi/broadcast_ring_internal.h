@@ -0,0 +1,266 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// broadcast ring (disruptor style), every subscribed consumer reads every message
+// message is written once into ring cell and published with cell sequence, consumers read it in place and advance their
+// own cursors. Producers are gated by slowest consumer cursor which is cached and recomputed only when cached value
+// does not allow to claim cell. Multi producer variant claims sequences with fetch_add.
+
+#pragma once
+
+#include "common_utils.h"
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace ampi
+{
+  enum struct producer_mode { single, multi };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // broadcast_ring_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, producer_mode MODE = producer_mode::single>
+  class broadcast_ring_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using sequence_type = uint64_t;
+    static constexpr producer_mode mode = MODE;
+    static constexpr int no_consumer = -1;
+
+  private:
+    static constexpr sequence_type free_cursor = std::numeric_limits<sequence_type>::max();
+
+    struct cell_t
+      {
+      // sequence + 1 of published message, 0 before first write
+      std::atomic<sequence_type> sequence;
+      user_obj_type              value;
+      };
+
+    struct alignas(64) cursor_t
+      {
+      std::atomic<sequence_type> position;
+      };
+
+    alignas(64) std::atomic<sequence_type> claim_;
+    alignas(64) std::atomic<sequence_type> gating_;
+    std::unique_ptr<cell_t[]>              cells_;
+    std::unique_ptr<cursor_t[]>            cursors_;
+    sequence_type                          mask_;
+    uint32_t                               max_consumers_;
+
+  public:
+    uint64_t capacity() const noexcept { return mask_ + 1; }
+    uint32_t max_consumers() const noexcept { return max_consumers_; }
+
+  public:
+    ///\param capacity is rounded up to power of 2
+    broadcast_ring_internal_tmpl( uint64_t capacity, uint32_t max_consumers );
+    broadcast_ring_internal_tmpl( broadcast_ring_internal_tmpl const & ) = delete;
+    broadcast_ring_internal_tmpl & operator=( broadcast_ring_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief registers consumer which will see messages pushed from now on
+    ///\returns consumer id or no_consumer when all consumer slots are taken
+    int subscribe() noexcept;
+    void unsubscribe( int consumer ) noexcept;
+
+    ///\brief publishes message to all consumers, waits while slowest consumer is full ring behind
+    template<typename value_type>
+    void push( value_type && user_data );
+
+    ///\returns pointer to next message of consumer which stays valid until advance or nullptr when there is none
+    user_obj_type const * peek( int consumer ) const noexcept;
+    void advance( int consumer, sequence_type count = 1 ) noexcept;
+
+    bool pull( int consumer, user_obj_type & user_data );
+
+    ///\brief calls fn in place for every available message and advances consumer cursor once
+    ///\returns number of consumed messages
+    template<typename function>
+    sequence_type consume( int consumer, function const & fn );
+
+  private:
+    sequence_type claim() noexcept;
+    sequence_type min_cursor( sequence_type sequence ) const noexcept;
+    void wait_for_gating( sequence_type sequence ) noexcept;
+    };
+
+  template<typename T, producer_mode M>
+  broadcast_ring_internal_tmpl<T,M>::broadcast_ring_internal_tmpl( uint64_t capacity, uint32_t max_consumers ) :
+      claim_{}, gating_{}, mask_{}, max_consumers_{ max_consumers }
+    {
+    uint64_t size { 2 };
+    while( size < capacity )
+      size <<= 1;
+    mask_ = size - 1;
+    cells_ = std::make_unique<cell_t[]>( size );
+    for( sequence_type index{}; index != size; ++index )
+      cells_[index].sequence.store( 0, std::memory_order_relaxed );
+    cursors_ = std::make_unique<cursor_t[]>( max_consumers );
+    for( uint32_t index{}; index != max_consumers; ++index )
+      cursors_[index].position.store( free_cursor, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    }
+
+  template<typename T, producer_mode M>
+  int broadcast_ring_internal_tmpl<T,M>::subscribe() noexcept
+    {
+    for( uint32_t index{}; index != max_consumers_; ++index )
+      {
+      sequence_type expected { free_cursor };
+      sequence_type position { claim_.load( std::memory_order_seq_cst ) };
+      if( !cursors_[index].position.compare_exchange_strong( expected, position, std::memory_order_seq_cst ) )
+        continue;
+      // producers which claimed before cursor became visible did not gate on it, move past them when they could
+      // overwrite cell at cursor
+      for( sequence_type claimed { claim_.load( std::memory_order_seq_cst ) }; claimed - position >= capacity();
+           claimed = claim_.load( std::memory_order_seq_cst ) )
+        {
+        position = claimed;
+        cursors_[index].position.store( position, std::memory_order_seq_cst );
+        }
+      return static_cast<int>( index );
+      }
+    return no_consumer;
+    }
+
+  template<typename T, producer_mode M>
+  void broadcast_ring_internal_tmpl<T,M>::unsubscribe( int consumer ) noexcept
+    {
+    cursors_[consumer].position.store( free_cursor, std::memory_order_release );
+    }
+
+  template<typename T, producer_mode M>
+  typename broadcast_ring_internal_tmpl<T,M>::sequence_type
+  broadcast_ring_internal_tmpl<T,M>::claim() noexcept
+    {
+    if constexpr( mode == producer_mode::multi )
+      return claim_.fetch_add( 1, std::memory_order_seq_cst );
+    else
+      {
+      sequence_type const sequence { claim_.load( std::memory_order_relaxed ) };
+      claim_.store( sequence + 1, std::memory_order_seq_cst );
+      return sequence;
+      }
+    }
+
+  template<typename T, producer_mode M>
+  typename broadcast_ring_internal_tmpl<T,M>::sequence_type
+  broadcast_ring_internal_tmpl<T,M>::min_cursor( sequence_type sequence ) const noexcept
+    {
+    // without consumers producer is gated only by its own sequence, cached value never exceeds later subscription
+    sequence_type result { sequence };
+    for( uint32_t index{}; index != max_consumers_; ++index )
+      {
+      sequence_type const position { cursors_[index].position.load( std::memory_order_acquire ) };
+      if( position < result )
+        result = position;
+      }
+    return result;
+    }
+
+  template<typename T, producer_mode M>
+  void broadcast_ring_internal_tmpl<T,M>::wait_for_gating( sequence_type sequence ) noexcept
+    {
+    while( sequence >= gating_.load( std::memory_order_acquire ) + capacity() )
+      {
+      sequence_type const gating { min_cursor( sequence ) };
+      gating_.store( gating, std::memory_order_release );
+      if( sequence < gating + capacity() )
+        break;
+      std::this_thread::yield();
+      }
+    if constexpr( mode == producer_mode::multi )
+      {
+      // producer of previous lap may still be writing cell when nobody gates
+      sequence_type const previous { sequence >= capacity() ? sequence - capacity() + 1 : 0 };
+      while( cells_[sequence & mask_].sequence.load( std::memory_order_acquire ) != previous )
+        std::this_thread::yield();
+      }
+    }
+
+  template<typename T, producer_mode M>
+  template<typename value_type>
+  void broadcast_ring_internal_tmpl<T,M>::push( value_type && user_data )
+    {
+    sequence_type const sequence { claim() };
+    wait_for_gating( sequence );
+    cell_t & cell { cells_[sequence & mask_] };
+    cell.value = std::forward<value_type>( user_data );
+    cell.sequence.store( sequence + 1, std::memory_order_release );
+    }
+
+  template<typename T, producer_mode M>
+  typename broadcast_ring_internal_tmpl<T,M>::user_obj_type const *
+  broadcast_ring_internal_tmpl<T,M>::peek( int consumer ) const noexcept
+    {
+    sequence_type const position { cursors_[consumer].position.load( std::memory_order_relaxed ) };
+    cell_t const & cell { cells_[position & mask_] };
+    if( cell.sequence.load( std::memory_order_acquire ) != position + 1 )
+      return nullptr;
+    return &cell.value;
+    }
+
+  template<typename T, producer_mode M>
+  void broadcast_ring_internal_tmpl<T,M>::advance( int consumer, sequence_type count ) noexcept
+    {
+    std::atomic<sequence_type> & position { cursors_[consumer].position };
+    position.store( position.load( std::memory_order_relaxed ) + count, std::memory_order_release );
+    }
+
+  template<typename T, producer_mode M>
+  bool broadcast_ring_internal_tmpl<T,M>::pull( int consumer, user_obj_type & user_data )
+    {
+    user_obj_type const * value { peek( consumer ) };
+    if( value == nullptr )
+      return false;
+    user_data = *value;
+    advance( consumer );
+    return true;
+    }
+
+  template<typename T, producer_mode M>
+  template<typename function>
+  typename broadcast_ring_internal_tmpl<T,M>::sequence_type
+  broadcast_ring_internal_tmpl<T,M>::consume( int consumer, function const & fn )
+    {
+    sequence_type const position { cursors_[consumer].position.load( std::memory_order_relaxed ) };
+    sequence_type count {};
+    for( ; count != capacity(); ++count )
+      {
+      cell_t const & cell { cells_[(position + count) & mask_] };
+      if( cell.sequence.load( std::memory_order_acquire ) != position + count + 1 )
+        break;
+      fn( cell.value );
+      }
+    if( count != 0 )
+      cursors_[consumer].position.store( position + count, std::memory_order_release );
+    return count;
+    }
+}
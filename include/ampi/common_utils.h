@@ -30,12 +30,20 @@
 #include <memory>
 #include <unistd.h>
 #include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <ctime>
+#include <climits>
+#include <cerrno>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 namespace ampi
 {
   inline void sleep( uint32_t ms ) { usleep(ms*1000); }
   
-  enum struct memorder : int { relaxed = __ATOMIC_RELAXED, acquire = __ATOMIC_ACQUIRE,  release = __ATOMIC_RELEASE, acq_rel = __ATOMIC_ACQ_REL };
+  enum struct memorder : int { relaxed = __ATOMIC_RELAXED, acquire = __ATOMIC_ACQUIRE,  release = __ATOMIC_RELEASE, acq_rel = __ATOMIC_ACQ_REL, seq_cst = __ATOMIC_SEQ_CST };
   
 
   template<typename T, typename U>
@@ -51,6 +59,12 @@ namespace ampi
     }
     
   
+  template<typename type>
+  inline void atomic_store( type * ref, type value, memorder order) noexcept
+    {
+    __atomic_store_n( ref, value, static_cast<int>(order) );
+    }
+
   template<typename type>
   inline type atomic_add_fetch(type * ptr, type value, memorder order ) noexcept
     { return __atomic_add_fetch ( ptr, value, static_cast<int>(order)); }
@@ -58,6 +72,61 @@ namespace ampi
   template<typename type>
   inline type atomic_sub_fetch(type * ptr, type value, memorder order ) noexcept
     { return __atomic_sub_fetch ( ptr, value, static_cast<int>(order)); } 
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // thread helpers
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\returns small sequential number of calling thread, assigned at first call
+  inline uint32_t this_thread_index() noexcept
+    {
+    static std::atomic<uint32_t> thread_counter{};
+    thread_local uint32_t const index { thread_counter.fetch_add( 1, std::memory_order_relaxed ) };
+    return index;
+    }
+
+  ///\returns cheap thread local xorshift pseudo random value
+  inline uint32_t thread_random() noexcept
+    {
+    thread_local uint32_t state { (this_thread_index() * 0x9E3779B9u + 0x7F4A7C15u) | 1u };
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+    }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // futex
+  //
+  // process_shared futex may be placed in memory shared between processes
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief sleeps while *addr == expected
+  ///\param timeout_ms relative timeout, negative value waits infinitely
+  ///\returns false on timeout
+  inline bool futex_wait( uint32_t * addr, uint32_t expected, long timeout_ms, bool process_shared ) noexcept
+    {
+    timespec timeout{ timeout_ms / 1000, (timeout_ms % 1000) * 1000000 };
+    int const op { process_shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE };
+    long res { syscall( SYS_futex, addr, op, expected, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0 ) };
+    return res == 0 || errno != ETIMEDOUT;
+    }
+
+  ///\brief wakes up to count threads sleeping on addr
+  inline void futex_wake( uint32_t * addr, int count, bool process_shared ) noexcept
+    {
+    int const op { process_shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE };
+    syscall( SYS_futex, addr, op, count, nullptr, nullptr, 0 );
+    }
+
+  ///\brief calls notify() of NOTIFIER when leaving scope, also when guarded push throws after publishing element
+  template<typename NOTIFIER>
+  struct notify_on_exit_t
+    {
+    NOTIFIER & notifier;
+    ~notify_on_exit_t() { notifier.notify(); }
+    };
     
   //----------------------------------------------------------------------------------------------------------------------
   //
@@ -164,6 +233,140 @@ namespace ampi
     data.ptr_value = reinterpret_cast<intptr_t>(value) & 0xFFFFFFFFFFFFllu;
     }
 
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // index_pointer_t
+  //
+  // used by arena backed containers, holds 32bit node index with 32bit tag in one 64bit cas word
+  // index 0 is reserved as null
+  //----------------------------------------------------------------------------------------------------------------------
+  union index_pointer_t
+    {
+  public:
+    using index_type = uint32_t;
+    using tag_type = uint32_t;
+    static constexpr index_type null_index = 0;
+
+    struct data_t
+      {
+      index_type index;
+      tag_type   tag;
+      } data;
+    int64_t cas_value;
+
+  public:
+    constexpr index_pointer_t() noexcept : cas_value( 0 ) {}
+    constexpr index_pointer_t( index_type i, tag_type t ) noexcept : data{ i, t } {}
+    explicit constexpr index_pointer_t( int64_t value ) noexcept : cas_value( value ) {}
+    index_pointer_t( index_pointer_t const & other ) noexcept = default;
+    index_pointer_t & operator =( index_pointer_t const & other ) noexcept = default;
+
+    bool operator ==( index_pointer_t const & other ) const noexcept { return cas_value == other.cas_value; }
+    bool operator !=( index_pointer_t const & other ) const noexcept { return cas_value != other.cas_value; }
+
+    index_type index() const noexcept { return data.index; }
+    tag_type   tag() const noexcept   { return data.tag; }
+    explicit operator bool() const noexcept { return data.index != null_index; }
+    };
+  static_assert( sizeof(index_pointer_t) == 8, "index_pointer_t must fit in single cas word" );
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // slab_ptr_t
+  // owns container header with trailing node slab allocated as single cache line aligned block
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename BASE_TYPE>
+  struct slab_deleter_t
+    {
+    void operator()( BASE_TYPE * base ) const noexcept
+      {
+      base->~BASE_TYPE();
+      ::operator delete( static_cast<void *>(base), std::align_val_t{ alignof(BASE_TYPE) } );
+      }
+    };
+
+  template<typename BASE_TYPE>
+  using slab_ptr_t = std::unique_ptr<BASE_TYPE,slab_deleter_t<BASE_TYPE>>;
+
+  template<typename BASE_TYPE, typename capacity_type>
+  slab_ptr_t<BASE_TYPE> make_slab( capacity_type capacity )
+    {
+    void * storage { ::operator new( BASE_TYPE::storage_size( capacity ), std::align_val_t{ alignof(BASE_TYPE) } ) };
+    try
+      {
+      return slab_ptr_t<BASE_TYPE>{ new (storage) BASE_TYPE( capacity ) };
+      }
+    catch(...)
+      {
+      ::operator delete( storage, std::align_val_t{ alignof(BASE_TYPE) } );
+      throw;
+      }
+    }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // allocate_node, node_ptr_t
+  // node allocation through user supplied allocator rebound to node type
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename NODE_TYPE, typename ALLOCATOR>
+  using node_allocator_traits = typename std::allocator_traits<ALLOCATOR>::template rebind_traits<NODE_TYPE>;
+
+  template<typename NODE_TYPE, typename ALLOCATOR, typename ... args_type>
+  NODE_TYPE * allocate_node( ALLOCATOR const & allocator, args_type && ... args )
+    {
+    using traits = node_allocator_traits<NODE_TYPE,ALLOCATOR>;
+    typename traits::allocator_type node_allocator{ allocator };
+    NODE_TYPE * node { traits::allocate( node_allocator, 1 ) };
+    try
+      {
+      traits::construct( node_allocator, node, std::forward<args_type>(args)... );
+      }
+    catch(...)
+      {
+      traits::deallocate( node_allocator, node, 1 );
+      throw;
+      }
+    return node;
+    }
+
+  template<typename NODE_TYPE, typename ALLOCATOR>
+  void deallocate_node( ALLOCATOR const & allocator, NODE_TYPE * node ) noexcept
+    {
+    using traits = node_allocator_traits<NODE_TYPE,ALLOCATOR>;
+    typename traits::allocator_type node_allocator{ allocator };
+    traits::destroy( node_allocator, node );
+    traits::deallocate( node_allocator, node, 1 );
+    }
+
+  template<typename NODE_TYPE, typename ALLOCATOR>
+  struct node_deleter_t
+    {
+    ALLOCATOR allocator;
+
+    void operator()( NODE_TYPE * node ) const noexcept { deallocate_node( allocator, node ); }
+    };
+
+  template<typename NODE_TYPE, typename ALLOCATOR>
+  using node_ptr_t = std::unique_ptr<NODE_TYPE,node_deleter_t<NODE_TYPE,ALLOCATOR>>;
+
+  ///\brief exchanges allocators held by iterators, also when allocator is not assignable like polymorphic_allocator
+  template<typename ALLOCATOR>
+  void swap_allocators( ALLOCATOR & l, ALLOCATOR & r ) noexcept
+    {
+    if constexpr( std::is_move_assignable<ALLOCATOR>::value )
+      std::swap( l, r );
+    else
+      {
+      ALLOCATOR tmp{ l };
+      l.~ALLOCATOR();
+      new (&l) ALLOCATOR( r );
+      r.~ALLOCATOR();
+      new (&r) ALLOCATOR( tmp );
+      }
+    }
+
   //----------------------------------------------------------------------------------------------------------------------
   //
   // node_t
@@ -0,0 +1,221 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// conflating (last value) queue keyed by message identity
+// keys are interned once into open addressing insert only slot table, every slot holds pointer to latest value.
+// Producer exchanges new value into slot, when slot was clean its index is queued in ready ring, otherwise previous
+// value is dropped (conflated). Consumer takes index from ring and exchanges slot value with null so it always sees
+// latest value for the key. At most one index per slot is queued so ring of slot count never fills.
+
+#pragma once
+
+#include "common_utils.h"
+#include "ring_internal.h"
+#include <functional>
+#include <utility>
+
+namespace ampi
+{
+  template<typename KEY_TYPE, typename USER_OBJ_TYPE>
+  struct conflating_slot_t
+    {
+    enum : uint32_t { empty, writing, ready };
+
+    std::atomic<uint32_t>        state;
+    KEY_TYPE                     key;
+    std::atomic<USER_OBJ_TYPE *> value;
+
+    conflating_slot_t() : state{ empty }, key{}, value{} {}
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // conflating_queue_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief multi producer multi consumer queue keeping only latest value per key
+  ///\description @{
+  /// keys are ordered by time they became dirty, republishing dirty key replaces value without changing its position.
+  /// Number of distinct keys is bounded by max_keys given at construction, keys are never removed.
+  ///@}
+  template<typename KEY_TYPE, typename USER_OBJ_TYPE, typename HASH = std::hash<KEY_TYPE>,
+           typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class conflating_queue_internal_tmpl
+    {
+  public:
+    using key_type = KEY_TYPE;
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using slot_type = conflating_slot_t<key_type,user_obj_type>;
+    using ready_type = ring_internal_tmpl<uint32_t>;
+    using size_type = long;
+
+  private:
+    std::unique_ptr<slot_type[]>  slots_;
+    uint32_t                      mask_;
+    uint32_t                      max_keys_;
+    slab_ptr_t<ready_type>        ready_;
+    HASH                          hash_;
+    allocator_type                allocator_;
+    alignas(64) std::atomic<uint32_t>   keys_;
+    alignas(64) std::atomic<size_type>  size_;
+    alignas(64) std::atomic<size_type>  conflated_;
+
+  public:
+    ///\returns number of keys with pending value
+    size_type   size() const noexcept              { return size_.load( std::memory_order_acquire ); }
+    bool        empty() const noexcept             { return size() <= 0; }
+    ///\returns number of distinct keys seen so far
+    uint32_t    key_count() const noexcept         { return keys_.load( std::memory_order_acquire ); }
+    uint32_t    max_keys() const noexcept          { return max_keys_; }
+    ///\returns allocator of published values, key table and ready ring are allocated once at construction from heap
+    allocator_type get_allocator() const noexcept  { return allocator_; }
+    ///\returns number of values dropped because newer value for the same key arrived before consumer
+    size_type   conflated() const noexcept         { return conflated_.load( std::memory_order_relaxed ); }
+
+  public:
+    explicit conflating_queue_internal_tmpl( uint32_t max_keys, HASH const & hash = HASH{},
+                                             allocator_type const & allocator = allocator_type{} );
+    ~conflating_queue_internal_tmpl();
+    conflating_queue_internal_tmpl( conflating_queue_internal_tmpl const & ) = delete;
+    conflating_queue_internal_tmpl & operator=( conflating_queue_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief publishes value for key replacing any value not yet consumed
+    ///\returns false when key is new and key table already holds max_keys keys
+    template<typename value_type>
+    bool push( key_type const & key, value_type && user_data );
+
+    ///\brief dequeues latest value of key that became dirty first
+    ///\returns false when no key has pending value
+    bool pull( key_type & key, user_obj_type & user_data );
+
+  private:
+    ///\returns slot index of key interning it when not present or null_index when key table is full
+    uint32_t find_or_insert( key_type const & key );
+    static constexpr uint32_t null_index = ~uint32_t{};
+    };
+
+  template<typename K, typename T, typename H, typename A>
+  conflating_queue_internal_tmpl<K,T,H,A>::conflating_queue_internal_tmpl( uint32_t max_keys, H const & hash,
+                                                                           allocator_type const & allocator ) :
+      slots_{},
+      mask_{ uint32_t( ready_type::round_capacity( uint64_t(max_keys) * 2 ) - 1 ) },
+      max_keys_{ max_keys },
+      ready_{ make_slab<ready_type>( uint64_t(mask_) + 1 ) },
+      hash_{ hash },
+      allocator_{ allocator },
+      keys_{},
+      size_{},
+      conflated_{}
+    {
+    assert( max_keys != 0 && max_keys < (1u << 30) );
+    slots_.reset( new slot_type[ std::size_t(mask_) + 1 ] );
+    }
+
+  template<typename K, typename T, typename H, typename A>
+  conflating_queue_internal_tmpl<K,T,H,A>::~conflating_queue_internal_tmpl()
+    {
+    for( uint32_t index{}; index <= mask_; ++index )
+      if( user_obj_type * value = slots_[index].value.load( std::memory_order_acquire ) )
+        deallocate_node( allocator_, value );
+    }
+
+  template<typename K, typename T, typename H, typename A>
+  uint32_t conflating_queue_internal_tmpl<K,T,H,A>::find_or_insert( key_type const & key )
+    {
+    uint32_t index { uint32_t( hash_( key ) ) & mask_ };
+    for( uint32_t probe{}; probe <= mask_; ++probe, index = ( index + 1 ) & mask_ )
+      {
+      slot_type & slot { slots_[index] };
+      uint32_t state { slot.state.load( std::memory_order_acquire ) };
+      if( state == slot_type::empty )
+        {
+        // table is never more than half full so probing always terminates on empty slot
+        uint32_t count { keys_.load( std::memory_order_relaxed ) };
+        do
+          if( count >= max_keys_ )
+            return null_index;
+        while( !keys_.compare_exchange_weak( count, count + 1, std::memory_order_relaxed ) );
+
+        if( slot.state.compare_exchange_strong( state, slot_type::writing, std::memory_order_acquire ) )
+          {
+          slot.key = key;
+          slot.state.store( slot_type::ready, std::memory_order_release );
+          return index;
+          }
+        // other producer claimed slot, give back reservation and check its key
+        keys_.fetch_sub( 1, std::memory_order_relaxed );
+        }
+      while( state == slot_type::writing )
+        state = slot.state.load( std::memory_order_acquire );
+      if( slot.key == key )
+        return index;
+      }
+    return null_index;
+    }
+
+  template<typename K, typename T, typename H, typename A>
+  template<typename value_type>
+  bool conflating_queue_internal_tmpl<K,T,H,A>::push( key_type const & key, value_type && user_data )
+    {
+    uint32_t const index { find_or_insert( key ) };
+    if( index == null_index )
+      return false;
+
+    user_obj_type * value { allocate_node<user_obj_type>( allocator_, std::forward<value_type>(user_data) ) };
+    user_obj_type * previous { slots_[index].value.exchange( value, std::memory_order_acq_rel ) };
+    if( previous == nullptr )
+      {
+      // slot became dirty, only this producer queues its index
+      size_.fetch_add( size_type{1}, std::memory_order_release );
+      bool const queued { ready_->push( uint32_t{ index } ) };
+      assert( queued );
+      (void)queued;
+      }
+    else
+      {
+      conflated_.fetch_add( size_type{1}, std::memory_order_relaxed );
+      deallocate_node( allocator_, previous );
+      }
+    return true;
+    }
+
+  template<typename K, typename T, typename H, typename A>
+  bool conflating_queue_internal_tmpl<K,T,H,A>::pull( key_type & key, user_obj_type & user_data )
+    {
+    uint32_t index;
+    if( !ready_->pull( index ) )
+      return false;
+
+    slot_type & slot { slots_[index] };
+    // index holder is the only thread that can clear slot so value is present
+    node_ptr_t<user_obj_type,allocator_type> value { slot.value.exchange( nullptr, std::memory_order_acq_rel ), { allocator_ } };
+    assert( value );
+    size_.fetch_sub( size_type{1}, std::memory_order_release );
+    key = slot.key;
+    user_data = std::move( *value );
+    return true;
+    }
+}
@@ -0,0 +1,384 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// delay queue, elements are released to consumers when their deadline passes
+// producers push into aggregated pop inbox with single cas. Consumer which takes wheel lock moves inbox into hierarchical
+// timing wheel (4 levels of 256 slots, insert is O(1)), advances wheel to current tick cascading higher levels down and
+// moves due elements into ready fifo. Idle consumers sleep on eventcount until next possible release, producers wake them
+// only when pushed deadline is earlier than planned wake up.
+
+#pragma once
+
+#include "common_utils.h"
+#include "afifo_internal.h"
+#include "fifo_internal.h"
+#include "eventcount.h"
+#include <array>
+#include <chrono>
+#include <limits>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // delay_queue_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class delay_queue_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using clock_type = std::chrono::steady_clock;
+    using time_point = clock_type::time_point;
+    using duration = clock_type::duration;
+    using tick_type = uint64_t;
+    using size_type = long;
+    static constexpr uint32_t slot_bits = 8;
+    static constexpr uint32_t slot_count = 1u << slot_bits;
+    static constexpr uint32_t level_count = 4;
+
+    struct timer_t
+      {
+      tick_type     deadline;
+      user_obj_type value;
+      };
+    using node_type = lifo_node_t<timer_t>;
+
+  private:
+    using slot_array_type = std::array<node_type *,slot_count>;
+    static constexpr tick_type slot_mask = slot_count - 1;
+    static constexpr tick_type wheel_range = tick_type{1} << (slot_bits * level_count);
+
+    alignas(64) std::atomic<size_type>   size_;
+    alignas(64) std::atomic<tick_type>   wake_tick_;
+    afifo_internal_tmpl<timer_t>         inbox_;
+    fifo_queue_internal_tmpl<node_type,allocator_type> ready_;
+    eventcount_t                         not_empty_;
+    duration                             tick_;
+    // wheel state is guarded by wheel_lock_
+    alignas(64) std::atomic<bool>        wheel_lock_;
+    tick_type                            current_;
+    size_type                            pending_;
+    std::array<size_type,level_count>    level_pending_;
+    std::array<slot_array_type,level_count> wheel_;
+
+  public:
+    bool        empty() const noexcept           { return size_.load(std::memory_order_acquire) <= 0; }
+    ///\returns number of pending and due elements
+    size_type   size() const  noexcept           { return size_.load(std::memory_order_acquire); }
+    ///\returns allocator of timer nodes and ready fifo nodes
+    allocator_type get_allocator() const noexcept { return ready_.get_allocator(); }
+
+  public:
+    ///\param tick resolution of wheel, elements are never released before deadline but up to one tick late
+    explicit delay_queue_internal_tmpl( duration tick = std::chrono::milliseconds{1},
+                                        allocator_type const & allocator = allocator_type{} );
+    ~delay_queue_internal_tmpl();
+    delay_queue_internal_tmpl( delay_queue_internal_tmpl const & ) = delete;
+    delay_queue_internal_tmpl & operator=( delay_queue_internal_tmpl const & ) = delete;
+
+  public:
+    void push( time_point deadline, user_obj_type && user_data );
+
+    ///\brief single try to take due element
+    bool pull( user_obj_type & user_data );
+
+    ///\brief sleeps until element becomes due
+    ///\param timeout_ms relative timeout, negative value waits infinitely
+    ///\returns false on timeout
+    bool pull_wait( user_obj_type & user_data, long timeout_ms = -1 );
+
+  private:
+    tick_type to_tick( time_point tm, bool round_up ) const noexcept;
+    bool try_lock_wheel() noexcept;
+    void unlock_wheel() noexcept { wheel_lock_.store( false, std::memory_order_release ); }
+    bool take_ready( user_obj_type & user_data );
+    ///\returns true when element is already due and was moved to ready fifo
+    bool insert( node_type * node );
+    size_type cascade( uint32_t level );
+    size_type advance( tick_type now_tick );
+    ///\returns tick when wheel may release next element or max when wheel is empty
+    tick_type next_release_tick() const noexcept;
+    };
+
+  template<typename T, typename A>
+  delay_queue_internal_tmpl<T,A>::delay_queue_internal_tmpl( duration tick, allocator_type const & allocator ) :
+      size_{},
+      wake_tick_{ std::numeric_limits<tick_type>::max() },
+      inbox_{},
+      ready_{ allocator },
+      not_empty_{},
+      tick_{ tick },
+      wheel_lock_{},
+      current_{},
+      pending_{},
+      level_pending_{},
+      wheel_{}
+    {
+    current_ = to_tick( clock_type::now(), false );
+    }
+
+  template<typename T, typename A>
+  delay_queue_internal_tmpl<T,A>::~delay_queue_internal_tmpl()
+    {
+    for( node_type * node { inbox_.pull() }; node != nullptr; )
+      {
+      node_type * next { node->next };
+      deallocate_node( get_allocator(), node );
+      node = next;
+      }
+    for( slot_array_type & level : wheel_ )
+      for( node_type * node : level )
+        while( node != nullptr )
+          {
+          node_type * next { node->next };
+          deallocate_node( get_allocator(), node );
+          node = next;
+          }
+    while( node_type * node = ready_.pull() )
+      deallocate_node( get_allocator(), node );
+    }
+
+  template<typename T, typename A>
+  typename delay_queue_internal_tmpl<T,A>::tick_type
+  delay_queue_internal_tmpl<T,A>::to_tick( time_point tm, bool round_up ) const noexcept
+    {
+    duration::rep const since_epoch { tm.time_since_epoch().count() };
+    duration::rep const tick { tick_.count() };
+    if( since_epoch <= 0 )
+      return 0;
+    return static_cast<tick_type>( round_up ? (since_epoch + tick - 1) / tick : since_epoch / tick );
+    }
+
+  template<typename T, typename A>
+  bool delay_queue_internal_tmpl<T,A>::try_lock_wheel() noexcept
+    {
+    return !wheel_lock_.load( std::memory_order_relaxed ) && !wheel_lock_.exchange( true, std::memory_order_acquire );
+    }
+
+  template<typename T, typename A>
+  void delay_queue_internal_tmpl<T,A>::push( time_point deadline, user_obj_type && user_data )
+    {
+    tick_type const deadline_tick { to_tick( deadline, true ) };
+    node_ptr_t<node_type,allocator_type> node { allocate_node<node_type>( get_allocator(), timer_t{ deadline_tick, std::move(user_data) } ),
+                                                { get_allocator() } };
+    inbox_.push( node.release() );
+    size_.fetch_add( size_type{1}, std::memory_order_relaxed );
+    // pairs with consumer which publishes wake_tick_ and then checks inbox
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( deadline_tick < wake_tick_.load( std::memory_order_relaxed ) )
+      not_empty_.notify();
+    }
+
+  template<typename T, typename A>
+  bool delay_queue_internal_tmpl<T,A>::insert( node_type * node )
+    {
+    tick_type const deadline { node->value.deadline };
+    if( deadline <= current_ )
+      {
+      ready_.push( node );
+      return true;
+      }
+    // deadlines beyond wheel range are parked in top level and cascaded again
+    tick_type const slot_tick { std::min( deadline, current_ + wheel_range - 1 ) };
+    tick_type const delta { slot_tick - current_ };
+    uint32_t level {};
+    while( level != level_count - 1 && delta >= (tick_type{1} << (slot_bits * (level + 1))) )
+      ++level;
+    node_type * & slot { wheel_[level][ (slot_tick >> (slot_bits * level)) & slot_mask ] };
+    node->next = slot;
+    slot = node;
+    ++level_pending_[level];
+    ++pending_;
+    return false;
+    }
+
+  template<typename T, typename A>
+  typename delay_queue_internal_tmpl<T,A>::size_type
+  delay_queue_internal_tmpl<T,A>::cascade( uint32_t level )
+    {
+    size_type released {};
+    node_type * & slot { wheel_[level][ (current_ >> (slot_bits * level)) & slot_mask ] };
+    node_type * node { slot };
+    slot = nullptr;
+    while( node != nullptr )
+      {
+      node_type * next { node->next };
+      --level_pending_[level];
+      --pending_;
+      if( insert( node ) )
+        ++released;
+      node = next;
+      }
+    return released;
+    }
+
+  template<typename T, typename A>
+  typename delay_queue_internal_tmpl<T,A>::size_type
+  delay_queue_internal_tmpl<T,A>::advance( tick_type now_tick )
+    {
+    size_type released {};
+    while( current_ < now_tick )
+      {
+      if( pending_ == 0 )
+        {
+        current_ = now_tick;
+        break;
+        }
+      // ticks before next boundary of first non empty level can not release anything
+      tick_type skip_mask {};
+      for( uint32_t level{}; level != level_count && level_pending_[level] == 0; ++level )
+        skip_mask = (skip_mask << slot_bits) | slot_mask;
+      if( skip_mask != 0 )
+        {
+        current_ = std::min( now_tick, current_ | skip_mask );
+        if( current_ == now_tick )
+          break;
+        }
+      ++current_;
+      // higher levels first, cascaded elements may land in lower level slot of this tick
+      for( uint32_t level{ level_count - 1 }; level != 0; --level )
+        if( (current_ & ((tick_type{1} << (slot_bits * level)) - 1)) == 0 )
+          released += cascade( level );
+      node_type * & slot { wheel_[0][ current_ & slot_mask ] };
+      for( node_type * node { slot }; node != nullptr; )
+        {
+        node_type * next { node->next };
+        --level_pending_[0];
+        --pending_;
+        ready_.push( node );
+        ++released;
+        node = next;
+        }
+      slot = nullptr;
+      }
+    return released;
+    }
+
+  template<typename T, typename A>
+  typename delay_queue_internal_tmpl<T,A>::tick_type
+  delay_queue_internal_tmpl<T,A>::next_release_tick() const noexcept
+    {
+    if( pending_ == 0 )
+      return std::numeric_limits<tick_type>::max();
+    if( level_pending_[0] != 0 )
+      for( tick_type tick { current_ + 1 }; tick != current_ + slot_count; ++tick )
+        if( wheel_[0][ tick & slot_mask ] != nullptr )
+          return tick;
+    // next cascade of first non empty level
+    tick_type skip_mask {};
+    for( uint32_t level{}; level != level_count && level_pending_[level] == 0; ++level )
+      skip_mask = (skip_mask << slot_bits) | slot_mask;
+    return (current_ | skip_mask) + 1;
+    }
+
+  template<typename T, typename A>
+  bool delay_queue_internal_tmpl<T,A>::take_ready( user_obj_type & user_data )
+    {
+    node_ptr_t<node_type,allocator_type> node { ready_.pull(), { get_allocator() } };
+    if( !node )
+      return false;
+    user_data = std::move( node->value.value );
+    size_.fetch_sub( size_type{1}, std::memory_order_release );
+    return true;
+    }
+
+  template<typename T, typename A>
+  bool delay_queue_internal_tmpl<T,A>::pull( user_obj_type & user_data )
+    {
+    if( take_ready( user_data ) )
+      return true;
+    if( try_lock_wheel() )
+      {
+      size_type released {};
+      try
+        {
+        for( node_type * node { inbox_.pull() }; node != nullptr; )
+          {
+          node_type * next { node->next };
+          if( insert( node ) )
+            ++released;
+          node = next;
+          }
+        released += advance( to_tick( clock_type::now(), false ) );
+        }
+      catch(...)
+        {
+        unlock_wheel();
+        throw;
+        }
+      unlock_wheel();
+      // more than one due element, let other consumers take them
+      if( released > 1 )
+        not_empty_.notify();
+      }
+    return take_ready( user_data );
+    }
+
+  template<typename T, typename A>
+  bool delay_queue_internal_tmpl<T,A>::pull_wait( user_obj_type & user_data, long timeout_ms )
+    {
+    using std::chrono::milliseconds;
+    time_point const wait_end { timeout_ms >= 0 ? clock_type::now() + milliseconds{ timeout_ms } : time_point::max() };
+    long const tick_ms { std::max( 1l, static_cast<long>( std::chrono::ceil<milliseconds>( tick_ ).count() ) ) };
+    for(;;)
+      {
+      if( pull( user_data ) )
+        return true;
+      // wheel busy, other consumer is releasing elements
+      long sleep_ms { tick_ms };
+      if( try_lock_wheel() )
+        {
+        tick_type const wake_tick { next_release_tick() };
+        wake_tick_.store( wake_tick, std::memory_order_seq_cst );
+        unlock_wheel();
+        if( wake_tick == std::numeric_limits<tick_type>::max() )
+          sleep_ms = -1;
+        else
+          {
+          tick_type const now_tick { to_tick( clock_type::now(), false ) };
+          tick_type const ticks { wake_tick > now_tick ? wake_tick - now_tick : 0 };
+          sleep_ms = std::max( 1l, static_cast<long>( std::chrono::ceil<milliseconds>( tick_ * ticks ).count() ) );
+          }
+        }
+      if( timeout_ms >= 0 )
+        {
+        time_point const now { clock_type::now() };
+        if( now >= wait_end )
+          return pull( user_data );
+        long const remaining { static_cast<long>( std::chrono::ceil<milliseconds>( wait_end - now ).count() ) };
+        sleep_ms = sleep_ms < 0 ? remaining : std::min( sleep_ms, remaining );
+        }
+      uint32_t const key { not_empty_.prepare_wait() };
+      if( !inbox_.empty() || !ready_.empty() )
+        {
+        not_empty_.cancel_wait();
+        continue;
+        }
+      not_empty_.wait( key, sleep_ms );
+      }
+    }
+}
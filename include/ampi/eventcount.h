@@ -0,0 +1,113 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <chrono>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // eventcount_t
+  //
+  // futex based eventcount, producers pay only check for present waiters
+  // holds no pointers so it may be placed in memory shared between processes
+  //----------------------------------------------------------------------------------------------------------------------
+  class eventcount_t
+    {
+    uint32_t seq_;
+    uint32_t waiters_;
+    uint32_t process_shared_;
+
+  public:
+    explicit eventcount_t( bool process_shared = false ) noexcept :
+        seq_{}, waiters_{}, process_shared_{ process_shared }
+      {}
+    eventcount_t( eventcount_t const & ) = delete;
+    eventcount_t & operator=( eventcount_t const & ) = delete;
+
+    ///\brief registers waiter, after call waiter must recheck condition and then call wait or cancel_wait
+    ///\returns key for wait
+    uint32_t prepare_wait() noexcept
+      {
+      atomic_add_fetch( &waiters_, 1u, memorder::seq_cst );
+      return atomic_load( &seq_, memorder::seq_cst );
+      }
+
+    void cancel_wait() noexcept
+      { atomic_sub_fetch( &waiters_, 1u, memorder::relaxed ); }
+
+    ///\brief sleeps until notify after prepare_wait returning key
+    ///\param timeout_ms relative timeout, negative value waits infinitely
+    ///\returns false on timeout
+    bool wait( uint32_t key, long timeout_ms = -1 ) noexcept
+      {
+      bool res { futex_wait( &seq_, key, timeout_ms, process_shared_ != 0 ) };
+      atomic_sub_fetch( &waiters_, 1u, memorder::relaxed );
+      return res;
+      }
+
+    ///\brief wakes all waiters, when there are no waiters costs single load
+    void notify() noexcept
+      {
+      __atomic_thread_fence( __ATOMIC_SEQ_CST );
+      if( atomic_load( &waiters_, memorder::relaxed ) != 0 )
+        {
+        atomic_add_fetch( &seq_, 1u, memorder::seq_cst );
+        futex_wake( &seq_, INT_MAX, process_shared_ != 0 );
+        }
+      }
+    };
+
+  ///\brief waits until try_fn succeeds using eventcount notifications
+  ///\param timeout_ms relative timeout of whole wait, negative value waits infinitely
+  ///\returns result of last try_fn call
+  template<typename try_function>
+  inline bool wait_for( eventcount_t & ec, long timeout_ms, try_function const & try_fn )
+    {
+    using clock_type = std::chrono::steady_clock;
+    // notifications for other conditions must not restart timeout, each sleep gets only remaining time
+    clock_type::time_point const deadline { clock_type::now() + std::chrono::milliseconds{ std::max( timeout_ms, 0l ) } };
+    for(;;)
+      {
+      if( try_fn() )
+        return true;
+      uint32_t const key { ec.prepare_wait() };
+      if( try_fn() )
+        {
+        ec.cancel_wait();
+        return true;
+        }
+      long remaining_ms { timeout_ms };
+      if( timeout_ms >= 0 )
+        remaining_ms = std::max( 0l, static_cast<long>(
+            std::chrono::ceil<std::chrono::milliseconds>( deadline - clock_type::now() ).count() ) );
+      if( !ec.wait( key, remaining_ms ) )
+        return try_fn();
+      }
+    }
+}
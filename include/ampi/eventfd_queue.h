@@ -0,0 +1,125 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// eventfd notification for queues consumed from epoll or io_uring event loops
+// consumer arms notifier when it finds queue empty, producer after push writes to eventfd only when it disarms it so
+// there is single syscall per empty to non empty transition instead of one per push.
+
+#pragma once
+
+#include "common_utils.h"
+#include <system_error>
+#include <utility>
+#include <sys/eventfd.h>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // eventfd_notifier_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  class eventfd_notifier_t
+    {
+    int               fd_;
+    std::atomic<bool> armed_;
+
+  public:
+    ///\brief creates non blocking eventfd, notifier starts armed
+    eventfd_notifier_t() : fd_{ ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) }, armed_{ true }
+      {
+      if( fd_ == -1 )
+        throw std::system_error( errno, std::generic_category(), "eventfd" );
+      }
+    ~eventfd_notifier_t() { ::close( fd_ ); }
+    eventfd_notifier_t( eventfd_notifier_t const & ) = delete;
+    eventfd_notifier_t & operator=( eventfd_notifier_t const & ) = delete;
+
+    ///\returns descriptor for registration with epoll or io_uring, readable when notified
+    int native_handle() const noexcept { return fd_; }
+
+    ///\brief producer side, signals eventfd when consumer armed notifier
+    void notify() noexcept
+      {
+      // pairs with arm in consumer which rechecks queue after arming
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( armed_.load( std::memory_order_relaxed ) && armed_.exchange( false, std::memory_order_acq_rel ) )
+        {
+        uint64_t const value { 1 };
+        ssize_t res { ::write( fd_, &value, sizeof(value) ) };
+        (void)res;
+        }
+      }
+
+    ///\brief consumer side, resets eventfd and arms notifier, caller must recheck queue afterwards
+    void arm() noexcept
+      {
+      uint64_t value;
+      ssize_t res { ::read( fd_, &value, sizeof(value) ) };
+      (void)res;
+      armed_.store( true, std::memory_order_seq_cst );
+      }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // eventfd_queue_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief queue with eventfd notifier signalled when queue becomes non empty
+  ///\description @{
+  /// event loop registers native_handle(), when descriptor fires it drains queue and calls rearm(),
+  /// when rearm returns false queue was refilled meanwhile and must be drained again
+  ///@}
+  template<typename QUEUE_TYPE>
+  class eventfd_queue_t
+      : public QUEUE_TYPE
+    {
+  public:
+    using base_type = QUEUE_TYPE;
+
+  private:
+    eventfd_notifier_t notifier_;
+
+  public:
+    template<typename ... arg_types>
+    explicit eventfd_queue_t( arg_types && ... args ) : base_type( std::forward<arg_types>(args)... ), notifier_{} {}
+
+    int native_handle() const noexcept { return notifier_.native_handle(); }
+
+    template<typename ... arg_types>
+    auto push( arg_types && ... args ) -> decltype( std::declval<base_type &>().push( std::forward<arg_types>(args)... ) )
+      {
+      notify_on_exit_t<eventfd_notifier_t> const notify { notifier_ };
+      return base_type::push( std::forward<arg_types>(args)... );
+      }
+
+    ///\returns true when queue is still empty after arming, false when it must be drained again
+    bool rearm() noexcept
+      {
+      notifier_.arm();
+      return base_type::empty();
+      }
+    };
+}
@@ -0,0 +1,200 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// unbounded mpmc fifo of linked array segments, slots are claimed with fetch_add instead of cas loop
+// (fetch and add array queue, idea of LCRQ by Morrison and Afek in simplified form by Ramalhete and Correia)
+// enqueuer takes index with fetch_add on tail segment and stores item with single cas on its slot, dequeuer takes index
+// with fetch_add on head segment and swaps slot with taken marker, when dequeuer is faster it marks slot taken and
+// enqueuer retries with next index. Exhausted head segments are retired through reclamation_domain_t.
+
+#pragma once
+
+#include "common_utils.h"
+#include "reclaim_internal.h"
+#include <array>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // faa_fifo_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class faa_fifo_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using user_obj_ptr_type = user_obj_type *;
+    using size_type = long;
+    static constexpr uint32_t segment_size = 1024;
+
+  private:
+    struct segment_t
+      {
+      alignas(64) std::atomic<uint32_t>   deq_index;
+      alignas(64) std::atomic<uint32_t>   enq_index;
+      alignas(64) std::atomic<segment_t *> next;
+      std::array<std::atomic<user_obj_ptr_type>,segment_size> items;
+      // retired segment may outlive queue in domain, so it carries allocator and retire record
+      allocator_type                       allocator;
+      reclamation_domain_t::retired_node_type retired;
+
+      segment_t( user_obj_ptr_type first_item, allocator_type const & alloc ) noexcept :
+          deq_index{}, enq_index{ first_item != nullptr ? 1u : 0u }, next{}, allocator{ alloc }, retired{}
+        {
+        items[0].store( first_item, std::memory_order_relaxed );
+        for( uint32_t index{1}; index != segment_size; ++index )
+          items[index].store( nullptr, std::memory_order_relaxed );
+        }
+      };
+
+    alignas(64) std::atomic<segment_t *>  head_;
+    alignas(64) std::atomic<segment_t *>  tail_;
+    alignas(64) std::atomic<size_type>    size_;
+    reclamation_domain_t &                domain_;
+    allocator_type                        allocator_;
+
+    static user_obj_ptr_type taken() noexcept { return reinterpret_cast<user_obj_ptr_type>( uintptr_t{1} ); }
+    static void destroy_segment( void * pointer ) noexcept;
+
+  public:
+    bool        empty() const noexcept           { return size_.load(std::memory_order_acquire) <= 0; }
+    size_type   size() const  noexcept           { return size_.load(std::memory_order_acquire); }
+    allocator_type get_allocator() const noexcept { return allocator_; }
+
+  public:
+    ///\param allocator segments retired to domain are freed by it later, so allocator must outlive domain not queue
+    explicit faa_fifo_internal_tmpl( reclamation_domain_t & domain = default_reclamation_domain(),
+                                     allocator_type const & allocator = allocator_type{} );
+    ~faa_fifo_internal_tmpl();
+    faa_fifo_internal_tmpl( faa_fifo_internal_tmpl const & ) = delete;
+    faa_fifo_internal_tmpl & operator=( faa_fifo_internal_tmpl const & ) = delete;
+
+  public:
+    void push( user_obj_type * user_data [[gnu::nonnull]] );
+    user_obj_type * pull();
+    };
+
+  template<typename T, typename A>
+  faa_fifo_internal_tmpl<T,A>::faa_fifo_internal_tmpl( reclamation_domain_t & domain, allocator_type const & allocator ) :
+      head_{}, tail_{}, size_{}, domain_{ domain }, allocator_{ allocator }
+    {
+    segment_t * segment { allocate_node<segment_t>( allocator_, nullptr, allocator_ ) };
+    head_.store( segment, std::memory_order_relaxed );
+    tail_.store( segment, std::memory_order_release );
+    }
+
+  template<typename T, typename A>
+  faa_fifo_internal_tmpl<T,A>::~faa_fifo_internal_tmpl()
+    {
+    // retired segments belong to domain, only linked ones are freed here
+    segment_t * segment { head_.load( std::memory_order_acquire ) };
+    while( segment != nullptr )
+      {
+      segment_t * next { segment->next.load( std::memory_order_relaxed ) };
+      destroy_segment( segment );
+      segment = next;
+      }
+    }
+
+  template<typename T, typename A>
+  void faa_fifo_internal_tmpl<T,A>::destroy_segment( void * pointer ) noexcept
+    {
+    segment_t * segment { static_cast<segment_t *>( pointer ) };
+    allocator_type const allocator { segment->allocator };
+    deallocate_node( allocator, segment );
+    }
+
+  template<typename T, typename A>
+  void faa_fifo_internal_tmpl<T,A>::push( user_obj_type * user_data [[gnu::nonnull]] )
+    {
+    reclamation_domain_t::guard_t guard{ domain_ };
+    for(;;)
+      {
+      segment_t * tail { tail_.load( std::memory_order_acquire ) };
+      uint32_t const index { tail->enq_index.fetch_add( 1, std::memory_order_acq_rel ) };
+      if( index < segment_size )
+        {
+        user_obj_ptr_type expected{};
+        if( tail->items[index].compare_exchange_strong( expected, user_data, std::memory_order_release, std::memory_order_relaxed ) )
+          break;
+        // slot was marked taken by faster dequeuer, retry with next index
+        continue;
+        }
+      // segment is full, append new one with item already in first slot
+      if( tail != tail_.load( std::memory_order_acquire ) )
+        continue;
+      segment_t * next { tail->next.load( std::memory_order_acquire ) };
+      if( next == nullptr )
+        {
+        node_ptr_t<segment_t,allocator_type> segment { allocate_node<segment_t>( allocator_, user_data, allocator_ ), { allocator_ } };
+        if( tail->next.compare_exchange_strong( next, segment.get(), std::memory_order_release, std::memory_order_relaxed ) )
+          {
+          tail_.compare_exchange_strong( tail, segment.release(), std::memory_order_release, std::memory_order_relaxed );
+          break;
+          }
+        }
+      else
+        // help lagging tail
+        tail_.compare_exchange_strong( tail, next, std::memory_order_release, std::memory_order_relaxed );
+      }
+    size_.fetch_add( size_type{1}, std::memory_order_release );
+    }
+
+  template<typename T, typename A>
+  typename faa_fifo_internal_tmpl<T,A>::user_obj_type *
+  faa_fifo_internal_tmpl<T,A>::pull()
+    {
+    reclamation_domain_t::guard_t guard{ domain_ };
+    for(;;)
+      {
+      segment_t * head { head_.load( std::memory_order_acquire ) };
+      // avoid burning slots when queue is empty
+      if( head->deq_index.load( std::memory_order_acquire ) >= head->enq_index.load( std::memory_order_acquire )
+          && head->next.load( std::memory_order_acquire ) == nullptr )
+        return nullptr;
+      uint32_t const index { head->deq_index.fetch_add( 1, std::memory_order_acq_rel ) };
+      if( index < segment_size )
+        {
+        user_obj_ptr_type item { head->items[index].exchange( taken(), std::memory_order_acq_rel ) };
+        if( item == nullptr )
+          // enqueuer of this slot did not store yet, it will fail and retry
+          continue;
+        size_.fetch_sub( size_type{1}, std::memory_order_release );
+        return item;
+        }
+      // segment is drained, move head to next segment
+      segment_t * next { head->next.load( std::memory_order_acquire ) };
+      if( next == nullptr )
+        return nullptr;
+      // tail must never point to retired segment, help it forward first
+      segment_t * tail { head };
+      tail_.compare_exchange_strong( tail, next, std::memory_order_release, std::memory_order_relaxed );
+      if( head_.compare_exchange_strong( head, next, std::memory_order_release, std::memory_order_relaxed ) )
+        domain_.retire( &head->retired, head, &destroy_segment );
+      }
+    }
+}
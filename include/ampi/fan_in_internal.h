@@ -0,0 +1,395 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// multi producer single consumer fan in over per producer single producer single consumer rings (lanes)
+// producer claims own lane on first push and afterwards writes only to its lane, producers never share cache line.
+// Consumer visits lanes round robin draining bounded batch from each for fairness, or merges lane heads by
+// producer timestamp for ordered fan in. Lanes use cached copy of opposite index so steady state touches shared
+// line only when cached view runs out.
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // fan_in_queue_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief bounded mpsc queue of per producer lanes, all pull and consume calls must come from single consumer thread
+  ///\description @{
+  /// push registers calling thread to free lane on first use and keeps it until thread exits or queue is destroyed, so
+  /// max_producers bounds number of concurrently living pushing threads. producer_t handle gives lane back earlier.
+  ///@}
+  template<typename USER_OBJ_TYPE>
+  class fan_in_queue_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using size_type = long;
+    using clock_type = std::chrono::steady_clock;
+    static constexpr uint32_t null_lane = std::numeric_limits<uint32_t>::max();
+    static constexpr std::size_t cache_line_size = 64;
+
+  private:
+    struct cell_t
+      {
+      user_obj_type value;
+      int64_t       stamp;
+      };
+
+    struct lane_t
+      {
+      alignas(cache_line_size) uint64_t tail;          ///< written by producer
+      uint64_t                           cached_head;
+      alignas(cache_line_size) uint64_t head;          ///< written by consumer
+      uint64_t                           cached_tail;
+      alignas(cache_line_size) std::atomic<uint32_t> owned;
+      std::unique_ptr<cell_t[]>          cells;
+      };
+
+    ///\brief shared with thread local lane registrations, outlives queue so exiting thread can tell it is gone
+    struct lifetime_t
+      {
+      static constexpr uint32_t destroyed = 1u << 31;
+      fan_in_queue_internal_tmpl * queue;
+      std::atomic<uint32_t>        state;   ///< destroyed flag and count of threads just releasing lane
+
+      explicit lifetime_t( fan_in_queue_internal_tmpl * owner ) noexcept : queue{ owner }, state{} {}
+      };
+
+    ///\brief lane implicitly claimed by push, owned by thread local registry and given back at thread exit
+    class registration_t
+      {
+      std::shared_ptr<lifetime_t> lifetime_;
+      uint32_t                    lane_;
+
+    public:
+      registration_t( std::shared_ptr<lifetime_t> const & lifetime, uint32_t lane ) noexcept :
+          lifetime_{ lifetime }, lane_{ lane }
+        {}
+      registration_t( registration_t && rh ) noexcept : lifetime_{ std::move(rh.lifetime_) }, lane_{ rh.lane_ } {}
+      registration_t & operator=( registration_t && rh ) noexcept
+        { std::swap( lifetime_, rh.lifetime_ ); std::swap( lane_, rh.lane_ ); return *this; }
+      ~registration_t()
+        {
+        if( !lifetime_ )
+          return;
+        // destructor of queue waits for releasing threads, so queue seen alive stays alive until count drops
+        if( ( lifetime_->state.fetch_add( 1, std::memory_order_acquire ) & lifetime_t::destroyed ) == 0 )
+          lifetime_->queue->release_lane( lane_ );
+        lifetime_->state.fetch_sub( 1, std::memory_order_release );
+        }
+
+      lifetime_t const * lifetime() const noexcept { return lifetime_.get(); }
+      uint32_t lane() const noexcept                { return lane_; }
+      bool expired() const noexcept
+        { return ( lifetime_->state.load( std::memory_order_relaxed ) & lifetime_t::destroyed ) != 0; }
+      };
+
+    std::unique_ptr<lane_t[]>   lanes_;
+    uint32_t                    max_producers_;
+    uint64_t                    mask_;
+    std::shared_ptr<lifetime_t> lifetime_;
+    bool                        timestamps_;
+    alignas(cache_line_size) std::atomic<uint32_t> lane_count_;
+    alignas(cache_line_size) uint32_t cursor_;
+
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    ///\brief RAII lane ownership for producer thread
+    class producer_t
+      {
+      fan_in_queue_internal_tmpl * queue_;
+      uint32_t                     lane_;
+
+    public:
+      producer_t() noexcept : queue_{}, lane_{ null_lane } {}
+      producer_t( fan_in_queue_internal_tmpl & queue, uint32_t lane ) noexcept : queue_{ &queue }, lane_{ lane } {}
+      producer_t( producer_t && rh ) noexcept : queue_{ rh.queue_ }, lane_{ rh.lane_ } { rh.lane_ = null_lane; }
+      producer_t & operator=( producer_t && rh ) noexcept { std::swap( queue_, rh.queue_ ); std::swap( lane_, rh.lane_ ); return *this; }
+      ~producer_t() { if( lane_ != null_lane ) queue_->release_lane( lane_ ); }
+
+      ///\returns false when no lane was available at construction
+      explicit operator bool() const noexcept { return lane_ != null_lane; }
+
+      ///\returns false when lane is full
+      template<typename value_type>
+      bool push( value_type && user_data )
+        { return lane_ != null_lane && queue_->push_lane( lane_, std::forward<value_type>(user_data) ); }
+      };
+
+  public:
+    size_type size() const noexcept;
+    bool      empty() const noexcept                 { return size() == 0; }
+    uint32_t  lane_count() const noexcept            { return lane_count_.load( std::memory_order_acquire ); }
+    uint64_t  lane_capacity() const noexcept         { return mask_ + 1; }
+
+  public:
+    ///\param lane_capacity elements per producer lane, rounded up to power of 2
+    ///\param timestamps stamp elements with steady clock so pull_ordered can merge lanes
+    fan_in_queue_internal_tmpl( uint64_t lane_capacity, uint32_t max_producers, bool timestamps = false );
+    ~fan_in_queue_internal_tmpl();
+    fan_in_queue_internal_tmpl( fan_in_queue_internal_tmpl const & ) = delete;
+    fan_in_queue_internal_tmpl & operator=( fan_in_queue_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief pushes to lane of calling thread registering it on first use
+    ///\returns false when lane is full or no lane is free
+    template<typename value_type>
+    bool push( value_type && user_data );
+
+    ///\returns handle owning free lane, empty handle when all lanes are taken
+    producer_t make_producer() { return producer_t{ *this, acquire_lane() }; }
+
+    ///\brief takes single element visiting lanes round robin
+    bool pull( user_obj_type & user_data );
+
+    ///\brief takes element with oldest timestamp among lane heads, requires timestamps
+    bool pull_ordered( user_obj_type & user_data );
+
+    ///\brief drains up to max_per_lane elements from every lane passing them to fn( user_obj_type && )
+    ///\returns number of consumed elements
+    template<typename function_type>
+    size_type consume( function_type && fn, size_type max_per_lane = 64 );
+
+  private:
+    uint32_t acquire_lane();
+    void release_lane( uint32_t lane ) noexcept { lanes_[lane].owned.store( 0, std::memory_order_release ); }
+    uint32_t this_thread_lane();
+    template<typename value_type>
+    bool push_lane( uint32_t lane, value_type && user_data );
+    ///\returns number of elements ready in lane from consumer view
+    uint64_t available( lane_t & lane ) noexcept;
+    };
+
+  template<typename T>
+  fan_in_queue_internal_tmpl<T>::fan_in_queue_internal_tmpl( uint64_t lane_capacity, uint32_t max_producers, bool timestamps ) :
+      lanes_{ new lane_t[ max_producers ] },
+      max_producers_{ max_producers },
+      mask_{},
+      lifetime_{ std::make_shared<lifetime_t>( this ) },
+      timestamps_{ timestamps },
+      lane_count_{},
+      cursor_{}
+    {
+    uint64_t capacity{ 2 };
+    while( capacity < lane_capacity )
+      capacity <<= 1;
+    mask_ = capacity - 1;
+    for( uint32_t index{}; index != max_producers_; ++index )
+      {
+      lane_t & lane { lanes_[index] };
+      lane.tail = lane.cached_head = lane.head = lane.cached_tail = 0;
+      lane.owned.store( 0, std::memory_order_relaxed );
+      }
+    }
+
+  template<typename T>
+  fan_in_queue_internal_tmpl<T>::~fan_in_queue_internal_tmpl()
+    {
+    // registrations of living threads must not touch lanes after this point
+    lifetime_->state.fetch_or( lifetime_t::destroyed, std::memory_order_acq_rel );
+    while( ( lifetime_->state.load( std::memory_order_acquire ) & ~lifetime_t::destroyed ) != 0 )
+      std::this_thread::yield();
+    }
+
+  template<typename T>
+  typename fan_in_queue_internal_tmpl<T>::size_type
+  fan_in_queue_internal_tmpl<T>::size() const noexcept
+    {
+    size_type result{};
+    uint32_t const count { lane_count() };
+    for( uint32_t index{}; index != count; ++index )
+      result += static_cast<size_type>( __atomic_load_n( &lanes_[index].tail, __ATOMIC_ACQUIRE )
+                                        - __atomic_load_n( &lanes_[index].head, __ATOMIC_ACQUIRE ) );
+    return result;
+    }
+
+  template<typename T>
+  uint32_t fan_in_queue_internal_tmpl<T>::acquire_lane()
+    {
+    for( uint32_t index{}; index != max_producers_; ++index )
+      {
+      lane_t & lane { lanes_[index] };
+      uint32_t free_lane{};
+      if( lane.owned.load( std::memory_order_relaxed ) == 0
+          && lane.owned.compare_exchange_strong( free_lane, 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+        {
+        // cells are published to consumer by release store of tail
+        if( !lane.cells )
+          lane.cells.reset( new cell_t[ mask_ + 1 ] );
+        uint32_t count { lane_count_.load( std::memory_order_relaxed ) };
+        while( count <= index
+               && !lane_count_.compare_exchange_weak( count, index + 1, std::memory_order_release, std::memory_order_relaxed ) );
+        return index;
+        }
+      }
+    return null_lane;
+    }
+
+  template<typename T>
+  uint32_t fan_in_queue_internal_tmpl<T>::this_thread_lane()
+    {
+    // registrations hold lifetime so its address is never reused by new queue while entry exists
+    thread_local std::vector<registration_t> registry;
+    for( std::size_t index{}; index != registry.size(); )
+      {
+      registration_t & entry { registry[index] };
+      if( entry.lifetime() == lifetime_.get() )
+        return entry.lane();
+      // drop entries of destroyed queues, swapped in entry is checked at same index
+      if( entry.expired() )
+        {
+        std::swap( entry, registry.back() );
+        registry.pop_back();
+        }
+      else
+        ++index;
+      }
+    uint32_t const lane { acquire_lane() };
+    if( lane != null_lane )
+      try
+        {
+        registry.emplace_back( lifetime_, lane );
+        }
+      catch(...)
+        {
+        release_lane( lane );
+        throw;
+        }
+    return lane;
+    }
+
+  template<typename T>
+  template<typename value_type>
+  bool fan_in_queue_internal_tmpl<T>::push( value_type && user_data )
+    {
+    uint32_t const lane { this_thread_lane() };
+    return lane != null_lane && push_lane( lane, std::forward<value_type>(user_data) );
+    }
+
+  template<typename T>
+  template<typename value_type>
+  bool fan_in_queue_internal_tmpl<T>::push_lane( uint32_t index, value_type && user_data )
+    {
+    lane_t & lane { lanes_[index] };
+    uint64_t const tail { lane.tail };
+    if( tail - lane.cached_head > mask_ )
+      {
+      lane.cached_head = __atomic_load_n( &lane.head, __ATOMIC_ACQUIRE );
+      if( tail - lane.cached_head > mask_ )
+        return false;
+      }
+    cell_t & cell { lane.cells[ tail & mask_ ] };
+    cell.value = std::forward<value_type>( user_data );
+    cell.stamp = timestamps_ ? clock_type::now().time_since_epoch().count() : 0;
+    __atomic_store_n( &lane.tail, tail + 1, __ATOMIC_RELEASE );
+    return true;
+    }
+
+  template<typename T>
+  uint64_t fan_in_queue_internal_tmpl<T>::available( lane_t & lane ) noexcept
+    {
+    if( lane.head == lane.cached_tail )
+      lane.cached_tail = __atomic_load_n( &lane.tail, __ATOMIC_ACQUIRE );
+    return lane.cached_tail - lane.head;
+    }
+
+  template<typename T>
+  bool fan_in_queue_internal_tmpl<T>::pull( user_obj_type & user_data )
+    {
+    uint32_t const count { lane_count() };
+    for( uint32_t probe{}; probe != count; ++probe )
+      {
+      uint32_t const index { ( cursor_ + probe ) % count };
+      lane_t & lane { lanes_[index] };
+      if( available( lane ) != 0 )
+        {
+        user_data = std::move( lane.cells[ lane.head & mask_ ].value );
+        __atomic_store_n( &lane.head, lane.head + 1, __ATOMIC_RELEASE );
+        // next pull starts from following lane so busy lane can not starve others
+        cursor_ = index + 1;
+        return true;
+        }
+      }
+    return false;
+    }
+
+  template<typename T>
+  bool fan_in_queue_internal_tmpl<T>::pull_ordered( user_obj_type & user_data )
+    {
+    assert( timestamps_ );
+    uint32_t const count { lane_count() };
+    lane_t * oldest {};
+    int64_t oldest_stamp { std::numeric_limits<int64_t>::max() };
+    for( uint32_t index{}; index != count; ++index )
+      {
+      lane_t & lane { lanes_[index] };
+      if( available( lane ) != 0 && lane.cells[ lane.head & mask_ ].stamp < oldest_stamp )
+        {
+        oldest = &lane;
+        oldest_stamp = lane.cells[ lane.head & mask_ ].stamp;
+        }
+      }
+    if( oldest == nullptr )
+      return false;
+    user_data = std::move( oldest->cells[ oldest->head & mask_ ].value );
+    __atomic_store_n( &oldest->head, oldest->head + 1, __ATOMIC_RELEASE );
+    return true;
+    }
+
+  template<typename T>
+  template<typename function_type>
+  typename fan_in_queue_internal_tmpl<T>::size_type
+  fan_in_queue_internal_tmpl<T>::consume( function_type && fn, size_type max_per_lane )
+    {
+    size_type result{};
+    uint32_t const count { lane_count() };
+    for( uint32_t probe{}; probe != count; ++probe )
+      {
+      lane_t & lane { lanes_[ ( cursor_ + probe ) % count ] };
+      uint64_t const batch { std::min<uint64_t>( available( lane ), uint64_t( max_per_lane ) ) };
+      uint64_t const head { lane.head };
+      for( uint64_t pos{ head }; pos != head + batch; ++pos )
+        fn( std::move( lane.cells[ pos & mask_ ].value ) );
+      // single release of whole batch back to producer
+      if( batch != 0 )
+        __atomic_store_n( &lane.head, head + batch, __ATOMIC_RELEASE );
+      result += static_cast<size_type>( batch );
+      }
+    if( count != 0 )
+      cursor_ = ( cursor_ + 1 ) % count;
+    return result;
+    }
+}
@@ -0,0 +1,227 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// flat combining fifo (Hendler, Incze, Shavit, Tzafrir)
+// thread publishes its request in publication slot and then either becomes combiner or waits, combiner holding the lock
+// applies all published requests in single pass against sequential queue. Preempted thread in the middle of operation
+// never blocks progress of others the way lagging tail does, it only delays requests it is combining.
+
+#pragma once
+
+#include "common_utils.h"
+#include <deque>
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // fc_fifo_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class fc_fifo_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<user_obj_type>;
+    using size_type = long;
+
+  private:
+    enum request_e : uint32_t { request_none, request_push, request_pull };
+
+    struct alignas(64) slot_t
+      {
+      std::atomic<uint32_t> owner;
+      std::atomic<uint32_t> request;
+      user_obj_type *       value;
+      bool                  result;
+      std::exception_ptr    error;
+      };
+
+    ///\brief releases combiner lock also when applied request throws
+    struct combiner_lock_t
+      {
+      std::atomic<uint32_t> & lock;
+      ~combiner_lock_t() { lock.store( 0, std::memory_order_release ); }
+      };
+
+    alignas(64) std::atomic<uint32_t>   lock_;
+    std::deque<user_obj_type,allocator_type> queue_;
+    alignas(64) std::atomic<size_type>  size_;
+    std::unique_ptr<slot_t[]>           slots_;
+    uint32_t                            mask_;
+
+  public:
+    bool        empty() const noexcept           { return size_.load(std::memory_order_acquire) == 0; }
+    size_type   size() const  noexcept           { return size_.load(std::memory_order_acquire); }
+    allocator_type get_allocator() const noexcept { return queue_.get_allocator(); }
+
+  public:
+    ///\param slot_count number of publication slots rounded up to power of 2, 0 selects twice the hardware concurrency
+    ///\param allocator used by sequential deque holding elements
+    explicit fc_fifo_internal_tmpl( uint32_t slot_count = 0, allocator_type const & allocator = allocator_type{} );
+    fc_fifo_internal_tmpl( fc_fifo_internal_tmpl const & ) = delete;
+    fc_fifo_internal_tmpl & operator=( fc_fifo_internal_tmpl const & ) = delete;
+
+  public:
+    void push( user_obj_type && user_data );
+
+    ///\returns false when queue is empty
+    bool pull( user_obj_type & user_data );
+
+  private:
+    bool execute( uint32_t request, user_obj_type * value );
+    bool apply( uint32_t request, user_obj_type * value );
+    slot_t & claim_slot() noexcept;
+    ///\brief serves all published requests, exception of request is stored in its slot and does not stop the pass
+    void combine() noexcept;
+    };
+
+  template<typename T, typename A>
+  fc_fifo_internal_tmpl<T,A>::fc_fifo_internal_tmpl( uint32_t slot_count, allocator_type const & allocator ) :
+      lock_{}, queue_( allocator ), size_{}
+    {
+    if( slot_count == 0 )
+      slot_count = std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+    uint32_t count{ 1 };
+    while( count < slot_count )
+      count <<= 1;
+    slots_ = std::make_unique<slot_t[]>( count );
+    mask_ = count - 1;
+    for( uint32_t index{}; index != count; ++index )
+      {
+      slots_[index].owner.store( 0, std::memory_order_relaxed );
+      slots_[index].request.store( request_none, std::memory_order_relaxed );
+      }
+    }
+
+  template<typename T, typename A>
+  typename fc_fifo_internal_tmpl<T,A>::slot_t &
+  fc_fifo_internal_tmpl<T,A>::claim_slot() noexcept
+    {
+    uint32_t const start { this_thread_index() };
+    for(;;)
+      {
+      for( uint32_t step{}; step <= mask_; ++step )
+        {
+        slot_t & slot { slots_[ (start + step) & mask_ ] };
+        uint32_t free_slot{};
+        if( slot.owner.load( std::memory_order_relaxed ) == 0
+            && slot.owner.compare_exchange_strong( free_slot, 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+          return slot;
+        }
+      std::this_thread::yield();
+      }
+    }
+
+  template<typename T, typename A>
+  bool fc_fifo_internal_tmpl<T,A>::apply( uint32_t request, user_obj_type * value )
+    {
+    if( request == request_push )
+      {
+      queue_.emplace_back( std::move( *value ) );
+      size_.fetch_add( size_type{1}, std::memory_order_release );
+      return true;
+      }
+    if( queue_.empty() )
+      return false;
+    *value = std::move( queue_.front() );
+    queue_.pop_front();
+    size_.fetch_sub( size_type{1}, std::memory_order_release );
+    return true;
+    }
+
+  template<typename T, typename A>
+  void fc_fifo_internal_tmpl<T,A>::combine() noexcept
+    {
+    // single pass over publication list, requests are served in slot order
+    for( uint32_t index{}; index <= mask_; ++index )
+      {
+      slot_t & slot { slots_[index] };
+      uint32_t const request { slot.request.load( std::memory_order_acquire ) };
+      if( request != request_none )
+        {
+        try
+          {
+          slot.result = apply( request, slot.value );
+          }
+        catch( ... )
+          {
+          slot.result = false;
+          slot.error = std::current_exception();
+          }
+        slot.request.store( request_none, std::memory_order_release );
+        }
+      }
+    }
+
+  template<typename T, typename A>
+  bool fc_fifo_internal_tmpl<T,A>::execute( uint32_t request, user_obj_type * value )
+    {
+    if( lock_.load( std::memory_order_relaxed ) == 0 && lock_.exchange( 1, std::memory_order_acquire ) == 0 )
+      {
+      // uncontended, apply own request directly and serve others
+      combiner_lock_t lock{ lock_ };
+      bool const result { apply( request, value ) };
+      combine();
+      return result;
+      }
+    slot_t & slot { claim_slot() };
+    slot.value = value;
+    slot.request.store( request, std::memory_order_release );
+    while( slot.request.load( std::memory_order_acquire ) != request_none )
+      {
+      // combiner left before seeing our request, take its role
+      if( lock_.load( std::memory_order_relaxed ) == 0 && lock_.exchange( 1, std::memory_order_acquire ) == 0 )
+        {
+        combiner_lock_t lock{ lock_ };
+        combine();
+        }
+      else
+        std::this_thread::yield();
+      }
+    bool const result { slot.result };
+    std::exception_ptr const error { std::move( slot.error ) };
+    slot.error = nullptr;
+    slot.owner.store( 0, std::memory_order_release );
+    if( error )
+      std::rethrow_exception( error );
+    return result;
+    }
+
+  template<typename T, typename A>
+  void fc_fifo_internal_tmpl<T,A>::push( user_obj_type && user_data )
+    {
+    execute( request_push, &user_data );
+    }
+
+  template<typename T, typename A>
+  bool fc_fifo_internal_tmpl<T,A>::pull( user_obj_type & user_data )
+    {
+    return execute( request_pull, &user_data );
+    }
+}
@@ -58,6 +58,27 @@ namespace ampi
     };
 
     
+  ///\brief node cache sizing of fifo_queue_internal_tmpl
+  ///\description @{
+  /// reclaim_slots nodes released by pull are held back before reuse so concurrent readers of old head do not touch
+  /// freed memory, less slots shorten that delay. Nodes leaving reclaim table are kept as spare nodes up to
+  /// max_spare_nodes and returned to allocator above it, spare nodes are opt in and by default every node leaving
+  /// reclaim table goes back to allocator.
+  ///@}
+  struct fifo_cache_config_t
+    {
+    uint32_t reclaim_slots   { 512 };
+    uint32_t max_spare_nodes { 0 };
+
+    ///\returns configuration for many mostly idle queues, few words of reclaim table and no spare nodes
+    ///\description @{
+    /// assumes type preserving allocator (pool or arena which never returns node memory to general heap).
+    /// Node is freed after 8 pulls instead of 512, with default heap allocator reader stalled on old head has much
+    /// wider window to touch memory already reused for something else.
+    ///@}
+    static constexpr fifo_cache_config_t tiny() noexcept { return fifo_cache_config_t{ 8, 0 }; }
+    };
+
   //----------------------------------------------------------------------------------------------------------------------
   //
   // fifo_queue_internal_tmpl
@@ -65,11 +86,12 @@ namespace ampi
   //----------------------------------------------------------------------------------------------------------------------
 
     
-  template<typename USER_OBJ_TYPE>
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
   class fifo_queue_internal_tmpl
     {
   public:
     using user_obj_type =  USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
     using node_type = fifo_node_t<user_obj_type *>;
     using pointer = node_type *;
     using pointer_type = pointer_t<node_type>;
@@ -89,51 +111,80 @@ namespace ampi
       pointer_type pointer;
       std::atomic<lock_counter_t> lock_counter;
       };
-    using reaclaim_array_t = std::array<reclaimed_t,512>;
+    using reaclaim_array_t = std::unique_ptr<reclaimed_t[]>;
     
     struct pimpl_t 
       {
       reaclaim_array_t                  delayed_reclamtion_;
+      uint32_t                          reclaim_slots_;
+      uint32_t                          max_spare_nodes_;
       std::atomic<reclaim_counter_type> reclaim_counter_;
       std::atomic<pointer_type>  head_;
       std::atomic<pointer_type>  tail_;
       std::atomic<size_type>     size_;
+      std::atomic<pointer_type>  spare_;
+      std::atomic<size_type>     spare_size_;
       
-      pimpl_t() : 
-          delayed_reclamtion_{},
+      explicit pimpl_t( fifo_cache_config_t config ) : 
+          delayed_reclamtion_{ new reclaimed_t[ std::max( config.reclaim_slots, 1u ) ] },
+          reclaim_slots_{ std::max( config.reclaim_slots, 1u ) },
+          max_spare_nodes_{ config.max_spare_nodes },
           reclaim_counter_{},
           head_{},
           tail_{},
-          size_{} 
+          size_{},
+          spare_{},
+          spare_size_{}
         {}
+      reclaimed_t * begin() noexcept { return delayed_reclamtion_.get(); }
+      reclaimed_t * end() noexcept { return delayed_reclamtion_.get() + reclaim_slots_; }
       };
     std::unique_ptr<pimpl_t>  data_;
+    allocator_type            allocator_;
       
   public:
+    allocator_type get_allocator() const noexcept { return allocator_; }
     bool        empty() const noexcept           { return data_->size_.load(std::memory_order_acquire) == 0; }
     size_type   size() const  noexcept           { return data_->size_.load(std::memory_order_acquire); }
+    ///\returns number of idle nodes kept for reuse outside of reclaim table
+    size_type   spare_size() const noexcept      { return data_->spare_size_.load(std::memory_order_acquire); }
 
   public:
-    fifo_queue_internal_tmpl();
+    explicit fifo_queue_internal_tmpl( allocator_type const & allocator = allocator_type{},
+                                       fifo_cache_config_t config = fifo_cache_config_t{} );
     ~fifo_queue_internal_tmpl();
     fifo_queue_internal_tmpl( fifo_queue_internal_tmpl const & ) = delete;
     fifo_queue_internal_tmpl & operator=( fifo_queue_internal_tmpl const & ) = delete;
   
   public:
     void push( user_obj_type * user_data );
+
+    ///\brief enqueues count elements in order linking them to queue with single cas
+    void push( user_obj_type * const * user_data, size_type count );
+
     user_obj_type * pull();
+
+    ///\brief allocates count spare nodes ahead of traffic, spare node limit does not apply
+    void reserve( size_type count );
+
+    ///\brief returns all spare nodes to allocator, must not run concurrently with push
+    ///\returns number of released nodes
+    size_type trim() noexcept;
     
   private:
-    typename reaclaim_array_t::iterator oldest_store() noexcept;
+    reclaimed_t * oldest_store() noexcept;
     void delay_reclamation( pointer_type ptr );
     pointer_type alloc();
+    void link( node_type * first, node_type * last, size_type count );
+    void push_spare( node_type * node ) noexcept;
+    node_type * pull_spare() noexcept;
   };
   
-  template<typename T>
-  typename fifo_queue_internal_tmpl<T>::reaclaim_array_t::iterator
-  fifo_queue_internal_tmpl<T>::oldest_store() noexcept
+  template<typename T, typename A>
+  typename fifo_queue_internal_tmpl<T,A>::reclaimed_t *
+  fifo_queue_internal_tmpl<T,A>::oldest_store() noexcept
     {
-    return std::min_element( std::begin(data_->delayed_reclamtion_), std::end(data_->delayed_reclamtion_),
+    return std::min_element( data_->begin(), data_->end(),
                           [](reclaimed_t const & l, reclaimed_t const & r)
                           {
                           lock_counter_t ll { l.lock_counter.load(std::memory_order_acquire) };
@@ -144,32 +195,87 @@ namespace ampi
                           } );
     }
     
-  template<typename T>
-  fifo_queue_internal_tmpl<T>::fifo_queue_internal_tmpl() :
-      data_{ std::make_unique<pimpl_t>() }
+  template<typename T, typename A>
+  fifo_queue_internal_tmpl<T,A>::fifo_queue_internal_tmpl( allocator_type const & allocator, fifo_cache_config_t config ) :
+      data_{ std::make_unique<pimpl_t>( config ) },
+      allocator_{ allocator }
     {
-    node_type * node = new node_type(); // Allocate a free node
+    node_type * node = allocate_node<node_type>( allocator_ ); // Allocate a free node
                       // Make it the only node in the linked list
     data_->head_.store( pointer_type( node ) );
     data_->tail_.store( pointer_type( node ) );        // Both Head and Tail point to it
     data_->reclaim_counter_ = 1;
     static_assert( sizeof(pointer_type) == 8, "64bit only supported TODO 32bit" );
-    for( reclaimed_t & el : data_->delayed_reclamtion_ )
+    for( reclaimed_t & el : *data_ )
       el.lock_counter.store(lock_counter_t{0,0});
     }
+
+  template<typename T, typename A>
+  void fifo_queue_internal_tmpl<T,A>::push_spare( node_type * node ) noexcept
+    {
+    pointer_type head;
+    do
+      {
+      head = data_->spare_.load( std::memory_order_acquire );
+      node->next.store( pointer_type{ head.get() }, std::memory_order_relaxed );
+      }
+    while( !data_->spare_.compare_exchange_weak( head, pointer_type{ node, head.count() + 1 }, std::memory_order_release, std::memory_order_relaxed ) );
+    data_->spare_size_.fetch_add( size_type{1}, std::memory_order_release );
+    }
+
+  template<typename T, typename A>
+  typename fifo_queue_internal_tmpl<T,A>::node_type *
+  fifo_queue_internal_tmpl<T,A>::pull_spare() noexcept
+    {
+    pointer_type head { data_->spare_.load( std::memory_order_acquire ) };
+    while( head.get() != nullptr )
+      {
+      // spare nodes pass reclaim table before they are freed, tag rejects stale next
+      pointer_type const next { head->next.load( std::memory_order_relaxed ) };
+      if( data_->spare_.compare_exchange_weak( head, pointer_type{ next.get(), head.count() + 1 }, std::memory_order_acquire, std::memory_order_acquire ) )
+        {
+        data_->spare_size_.fetch_sub( size_type{1}, std::memory_order_release );
+        return head.get();
+        }
+      }
+    return nullptr;
+    }
+
+  template<typename T, typename A>
+  void fifo_queue_internal_tmpl<T,A>::reserve( size_type count )
+    {
+    for( ; count > 0; --count )
+      push_spare( allocate_node<node_type>( allocator_ ) );
+    }
+
+  template<typename T, typename A>
+  typename fifo_queue_internal_tmpl<T,A>::size_type
+  fifo_queue_internal_tmpl<T,A>::trim() noexcept
+    {
+    size_type released{};
+    while( node_type * node = pull_spare() )
+      {
+      deallocate_node( allocator_, node );
+      ++released;
+      }
+    return released;
+    }
   
-  template<typename T>
-  typename fifo_queue_internal_tmpl<T>::pointer_type
-  fifo_queue_internal_tmpl<T>::alloc()
+  template<typename T, typename A>
+  typename fifo_queue_internal_tmpl<T,A>::pointer_type
+  fifo_queue_internal_tmpl<T,A>::alloc()
     {
-    auto to_reuse { std::find_if(std::begin(data_->delayed_reclamtion_), std::end(data_->delayed_reclamtion_), 
+    if( node_type * spare = pull_spare() )
+      return pointer_type{ spare };
+
+    auto to_reuse { std::find_if( data_->begin(), data_->end(), 
       []( reclaimed_t const & l )
       {
       lock_counter_t ll { l.lock_counter.load(std::memory_order_acquire) };
       return ll.lock == 0 && l.pointer.get() != nullptr;
       }) };
       
-    if( to_reuse != std::end(data_->delayed_reclamtion_) )
+    if( to_reuse != data_->end() )
       {
       reclaimed_t & el { *to_reuse };
       lock_counter_t lcexpected = el.lock_counter.load(std::memory_order_acquire);
@@ -184,12 +290,12 @@ namespace ampi
           return reclaim;
         }
       }
-    return pointer_type{ new node_type() };
+    return pointer_type{ allocate_node<node_type>( allocator_ ) };
     }
   
 
-  template<typename T>
-  void fifo_queue_internal_tmpl<T>::delay_reclamation( pointer_type reclaim )
+  template<typename T, typename A>
+  void fifo_queue_internal_tmpl<T,A>::delay_reclamation( pointer_type reclaim )
     {
     bool reclaimed {};
     do
@@ -212,8 +318,14 @@ namespace ampi
           el.lock_counter.store( lc_unlocked, std::memory_order_release );
         
           node_type * other_to_del { reclaim.get() };
+          // keep node leaving reclaim table for reuse while under spare limit
           if( other_to_del != nullptr )
-            delete other_to_del;
+            {
+            if( data_->spare_size_.load( std::memory_order_relaxed ) < size_type( data_->max_spare_nodes_ ) )
+              push_spare( other_to_del );
+            else
+              deallocate_node( allocator_, other_to_del );
+            }
           
           reclaimed = true;
           }
@@ -223,8 +335,8 @@ namespace ampi
 // //       printf("reclaim %X", (uintptr_t)old.get() );
     }
     
-  template<typename T>
-  fifo_queue_internal_tmpl<T>::~fifo_queue_internal_tmpl()
+  template<typename T, typename A>
+  fifo_queue_internal_tmpl<T,A>::~fifo_queue_internal_tmpl()
     {
     try 
       {
@@ -233,27 +345,69 @@ namespace ampi
 
       user_obj_type * any_data;
       while ((any_data = pull()) != nullptr);
-      delete data_->head_.load().get();
+      deallocate_node( allocator_, data_->head_.load().get() );
 //       delay_reclamation( pointer_type{} );
-      for( reclaimed_t & el : data_->delayed_reclamtion_ )
+      trim();
+      for( reclaimed_t & el : *data_ )
         {
         if( el.pointer.get () != nullptr )
-          delete el.pointer.get();
+          deallocate_node( allocator_, el.pointer.get() );
         }
       }
     catch(...)
       {}
     }
 
-  template<typename T>
-  void fifo_queue_internal_tmpl<T>::push( user_obj_type * user_data )
+  template<typename T, typename A>
+  void fifo_queue_internal_tmpl<T,A>::push( user_obj_type * user_data )
     {
-    pointer_type tail_local {};
     // Allocate a new node from the free list
     node_type * node{ alloc().get() };
     node->value = user_data; 
     // Set next pointer of node to NULL
     node->next = pointer_type{};
+    link( node, node, 1 );
+    }
+
+  template<typename T, typename A>
+  void fifo_queue_internal_tmpl<T,A>::push( user_obj_type * const * user_data, size_type count )
+    {
+    if( count <= 0 )
+      return;
+    // chain is built privately, only its first node is published
+    node_type * first{ alloc().get() };
+    first->value = user_data[0];
+    first->next = pointer_type{};
+    node_type * last{ first };
+    try
+      {
+      for( size_type index{1}; index != count; ++index )
+        {
+        node_type * node{ alloc().get() };
+        node->value = user_data[index];
+        node->next = pointer_type{};
+        last->next.store( pointer_type{ node, last->next.load( std::memory_order_relaxed ).count() + 1 }, std::memory_order_relaxed );
+        last = node;
+        }
+      }
+    catch(...)
+      {
+      // chain was never published, its nodes go to spare list which may hand out nodes other threads still read
+      for( node_type * node{ first }; node != nullptr; )
+        {
+        node_type * next{ node->next.load( std::memory_order_relaxed ).get() };
+        push_spare( node );
+        node = next;
+        }
+      throw;
+      }
+    link( first, last, count );
+    }
+
+  template<typename T, typename A>
+  void fifo_queue_internal_tmpl<T,A>::link( node_type * node, node_type * last, size_type count )
+    {
+    pointer_type tail_local {};
     // Keep trying until Enqueue is done
     for(;;)
       {
@@ -280,14 +434,14 @@ namespace ampi
           data_->tail_.compare_exchange_strong( tail_local, pointer_type{ next.get(), tail_local.count() + 1 }, std::memory_order_seq_cst );
         }
       }
-    // Enqueue is done.  Try to swing Tail to the inserted node
-    data_->tail_.compare_exchange_strong( tail_local, {node, tail_local.count() + 1} );
-    data_->size_.fetch_add( size_type{1}, std::memory_order_release );
+    // Enqueue is done.  Try to swing Tail to the inserted node, lagging tail over chain is advanced by other threads
+    data_->tail_.compare_exchange_strong( tail_local, {last, tail_local.count() + 1} );
+    data_->size_.fetch_add( count, std::memory_order_release );
     }
 
-  template<typename T>
-  typename fifo_queue_internal_tmpl<T>::user_obj_type *
-  fifo_queue_internal_tmpl<T>::pull()
+  template<typename T, typename A>
+  typename fifo_queue_internal_tmpl<T,A>::user_obj_type *
+  fifo_queue_internal_tmpl<T,A>::pull()
     {
     user_obj_type * pvalue{};
     pointer_type head;
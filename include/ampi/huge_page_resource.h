@@ -0,0 +1,203 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// memory resource carving nodes from single large anonymous mapping advised for transparent huge pages
+// nodes are handed out by bump pointer in allocation order so nodes linked by consecutive pushes share pages and TLB
+// entries. Freed blocks go to lock free lifo per size class and are reused, memory is returned to the system only
+// when resource is destroyed so nodes stay readable after deallocation as node reusing algorithms require.
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <memory_resource>
+#include <system_error>
+#include <sys/mman.h>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // huge_page_resource_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief std::pmr::memory_resource for container nodes backed by huge pages when available
+  ///\description @{
+  /// blocks larger than max_block_size, blocks with alignment above granule and allocations after reserved region is
+  /// exhausted are forwarded to upstream resource.
+  ///@}
+  class huge_page_resource_t : public std::pmr::memory_resource
+    {
+  public:
+    static constexpr std::size_t granule = 16;
+    static constexpr std::size_t max_block_size = 1024;
+    static constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+  private:
+    struct free_block_t
+      {
+      pointer_t<free_block_t> next;
+      };
+    using pointer_type = pointer_t<free_block_t>;
+    static constexpr std::size_t class_count = max_block_size / granule;
+
+    alignas(64) pointer_type      free_[class_count];
+    alignas(64) std::atomic<std::size_t> used_;
+    void *                        mapping_;
+    std::size_t                   mapping_size_;
+    char *                        begin_;
+    std::size_t                   capacity_;
+    std::pmr::memory_resource *   upstream_;
+    bool                          huge_pages_;
+
+  public:
+    ///\param reserve_bytes virtual address space to reserve, pages are committed on first touch
+    ///\param hugetlb try explicit MAP_HUGETLB pages first, falls back to transparent huge pages then to regular pages
+    explicit huge_page_resource_t( std::size_t reserve_bytes,
+                                   std::pmr::memory_resource * upstream = std::pmr::new_delete_resource(),
+                                   bool hugetlb = false );
+    ~huge_page_resource_t() override;
+    huge_page_resource_t( huge_page_resource_t const & ) = delete;
+    huge_page_resource_t & operator=( huge_page_resource_t const & ) = delete;
+
+    ///\returns true when region is backed by explicit huge pages or kernel accepted MADV_HUGEPAGE advice
+    bool        huge_pages() const noexcept     { return huge_pages_; }
+    std::size_t capacity() const noexcept       { return capacity_; }
+    ///\returns bytes carved from region so far, freed blocks are reused and do not lower it
+    std::size_t used() const noexcept           { return std::min( used_.load( std::memory_order_relaxed ), capacity_ ); }
+    std::pmr::memory_resource * upstream_resource() const noexcept { return upstream_; }
+    ///\returns true when p was carved from reserved region
+    bool owns( void const * p ) const noexcept
+      { return static_cast<char const *>(p) >= begin_ && static_cast<char const *>(p) < begin_ + capacity_; }
+
+    ///\brief sets preferred numa node of region pages, must be called before memory is touched
+    ///\returns false when kernel has no numa policy support or node does not exist
+    bool bind( uint32_t node ) noexcept;
+
+  protected:
+    void * do_allocate( std::size_t bytes, std::size_t alignment ) override;
+    void do_deallocate( void * p, std::size_t bytes, std::size_t alignment ) override;
+    bool do_is_equal( std::pmr::memory_resource const & other ) const noexcept override { return this == &other; }
+
+  private:
+    static std::size_t size_class( std::size_t bytes ) noexcept { return ( bytes + granule - 1 ) / granule - 1; }
+    };
+
+  inline huge_page_resource_t::huge_page_resource_t( std::size_t reserve_bytes, std::pmr::memory_resource * upstream,
+                                                     bool hugetlb ) :
+      free_{},
+      used_{},
+      mapping_{ MAP_FAILED },
+      mapping_size_{},
+      begin_{},
+      capacity_{},
+      upstream_{ upstream },
+      huge_pages_{}
+    {
+    std::size_t const size { ( reserve_bytes + huge_page_size - 1 ) / huge_page_size * huge_page_size };
+    if( hugetlb )
+      {
+      mapping_ = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_HUGETLB, -1, 0 );
+      if( mapping_ != MAP_FAILED )
+        {
+        mapping_size_ = size;
+        begin_ = static_cast<char *>( mapping_ );
+        huge_pages_ = true;
+        }
+      }
+    if( mapping_ == MAP_FAILED )
+      {
+      // over reserve so region start can be aligned to huge page boundary
+      mapping_size_ = size + huge_page_size;
+      mapping_ = ::mmap( nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+      if( mapping_ == MAP_FAILED )
+        throw std::system_error( errno, std::system_category(), "mmap" );
+      uintptr_t const aligned { ( reinterpret_cast<uintptr_t>( mapping_ ) + huge_page_size - 1 ) & ~uintptr_t( huge_page_size - 1 ) };
+      begin_ = reinterpret_cast<char *>( aligned );
+#ifdef MADV_HUGEPAGE
+      huge_pages_ = ::madvise( begin_, size, MADV_HUGEPAGE ) == 0;
+#endif
+      }
+    capacity_ = size;
+    }
+
+  inline huge_page_resource_t::~huge_page_resource_t()
+    {
+    if( mapping_ != MAP_FAILED )
+      ::munmap( mapping_, mapping_size_ );
+    }
+
+  inline bool huge_page_resource_t::bind( uint32_t node ) noexcept
+    {
+    constexpr int mpol_preferred { 1 };
+    unsigned long mask[4]{};
+    constexpr uint32_t mask_bits { sizeof(mask) * CHAR_BIT };
+    if( node >= mask_bits )
+      return false;
+    mask[ node / ( sizeof(unsigned long) * CHAR_BIT ) ] |= 1ul << ( node % ( sizeof(unsigned long) * CHAR_BIT ) );
+    return ::syscall( SYS_mbind, begin_, capacity_, mpol_preferred, mask, mask_bits, 0u ) == 0;
+    }
+
+  inline void * huge_page_resource_t::do_allocate( std::size_t bytes, std::size_t alignment )
+    {
+    if( bytes > max_block_size || alignment > granule )
+      return upstream_->allocate( bytes, alignment );
+
+    std::size_t const index { size_class( bytes != 0 ? bytes : 1 ) };
+    pointer_type & free_list { free_[index] };
+    pointer_type head { atomic_load( free_list, memorder::acquire ) };
+    while( head )
+      {
+      // freed blocks stay mapped, stale next is rejected by tag
+      pointer_type const next { __atomic_load_n( &head->next.cas_value, __ATOMIC_RELAXED ) };
+      if( cas( free_list, head, next.get(), head.count() + 1 ) )
+        return head.get();
+      head = atomic_load( free_list, memorder::acquire );
+      }
+
+    std::size_t const block_size { ( index + 1 ) * granule };
+    std::size_t const offset { used_.fetch_add( block_size, std::memory_order_relaxed ) };
+    if( offset + block_size <= capacity_ )
+      return begin_ + offset;
+    return upstream_->allocate( bytes, alignment );
+    }
+
+  inline void huge_page_resource_t::do_deallocate( void * p, std::size_t bytes, std::size_t alignment )
+    {
+    if( !owns( p ) )
+      {
+      upstream_->deallocate( p, bytes, alignment );
+      return;
+      }
+    free_block_t * block { static_cast<free_block_t *>( p ) };
+    pointer_type & free_list { free_[ size_class( bytes != 0 ? bytes : 1 ) ] };
+    pointer_type head;
+    do
+      {
+      head = atomic_load( free_list, memorder::acquire );
+      __atomic_store_n( &block->next.cas_value, pointer_type{ head.get() }.cas_value, __ATOMIC_RELAXED );
+      }
+    while( !cas( free_list, head, block, head.count() + 1 ) );
+    }
+}
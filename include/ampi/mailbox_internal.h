@@ -0,0 +1,246 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// compact mailboxes for large numbers of mostly idle queues, two words when empty and nothing allocated until first push
+// mpsc_mailbox_internal_tmpl: producers push to lifo inbox with single cas, consumer detaches whole inbox with exchange
+// and reverses it into private outbox, so no node is ever read by other thread after it was detached.
+// mailbox_internal_tmpl: Michael L. Scott fifo with dummy node installed lazily by first push, nodes are retired to
+// shared default_reclamation_domain() instead of per queue reclaim table.
+
+#pragma once
+
+#include "common_utils.h"
+#include "reclaim_internal.h"
+#include <utility>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // mpsc_mailbox_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief intrusive two word mpsc mailbox over lifo_node_t nodes, pull must be called from single consumer at a time
+  template<typename USER_OBJ_TYPE>
+  class mpsc_mailbox_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using node_type = lifo_node_t<user_obj_type>;
+    using pointer_type = node_type *;
+
+  private:
+    std::atomic<pointer_type> inbox_;
+    // written by consumer only, atomic so producers may read it in empty()
+    std::atomic<pointer_type> outbox_;
+
+  public:
+    ///\brief exact on consumer side, snapshot for producers which may miss nodes consumer is just moving to outbox
+    bool empty() const noexcept
+      {
+      return outbox_.load( std::memory_order_relaxed ) == nullptr && inbox_.load( std::memory_order_acquire ) == nullptr;
+      }
+
+  public:
+    mpsc_mailbox_internal_tmpl() noexcept : inbox_{}, outbox_{} {}
+    mpsc_mailbox_internal_tmpl( mpsc_mailbox_internal_tmpl const & ) = delete;
+    mpsc_mailbox_internal_tmpl & operator=( mpsc_mailbox_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief enqueues supplyied node, may be called concurrently from any number of threads
+    void push( node_type * node [[gnu::nonnull]] ) noexcept
+      {
+      pointer_type head { inbox_.load( std::memory_order_relaxed ) };
+      do
+        node->next = head;
+      while( !inbox_.compare_exchange_weak( head, node, std::memory_order_release, std::memory_order_relaxed ) );
+      }
+
+    ///\brief dequeues oldest node, consumer side only
+    ///\returns nullptr when mailbox is empty
+    node_type * pull() noexcept
+      {
+      pointer_type result { outbox_.load( std::memory_order_relaxed ) };
+      if( result == nullptr && inbox_.load( std::memory_order_relaxed ) != nullptr )
+        {
+        // inbox is newest first, reversing it gives fifo order
+        pointer_type node { inbox_.exchange( nullptr, std::memory_order_acquire ) };
+        while( node != nullptr )
+          {
+          pointer_type next { node->next };
+          node->next = result;
+          result = node;
+          node = next;
+          }
+        }
+      if( result != nullptr )
+        {
+        outbox_.store( result->next, std::memory_order_relaxed );
+        result->next = nullptr;
+        }
+      return result;
+      }
+    };
+
+  template<typename USER_OBJ_TYPE>
+  struct mailbox_node_t
+    {
+    using user_obj_type = USER_OBJ_TYPE;
+
+    user_obj_type                       value;
+    std::atomic<mailbox_node_t *>       next;
+
+    mailbox_node_t() : value{}, next{} {}
+    explicit mailbox_node_t( user_obj_type && data ) : value{ std::move(data) }, next{} {}
+    explicit mailbox_node_t( user_obj_type const & data ) : value{ data }, next{} {}
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // mailbox_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief two word mpmc fifo mailbox, dummy node is allocated by first push and nodes are reclaimed by shared domain
+  template<typename USER_OBJ_TYPE>
+  class mailbox_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using node_type = mailbox_node_t<user_obj_type>;
+    using pointer_type = node_type *;
+
+  private:
+    std::atomic<pointer_type> head_;
+    std::atomic<pointer_type> tail_;
+
+  public:
+    bool empty() const noexcept;
+
+  public:
+    mailbox_internal_tmpl() noexcept : head_{}, tail_{} {}
+    ~mailbox_internal_tmpl();
+    mailbox_internal_tmpl( mailbox_internal_tmpl const & ) = delete;
+    mailbox_internal_tmpl & operator=( mailbox_internal_tmpl const & ) = delete;
+
+  public:
+    template<typename value_type>
+    void push( value_type && user_data );
+
+    ///\returns false when mailbox is empty
+    bool pull( user_obj_type & user_data );
+
+  private:
+    static reclamation_domain_t & domain() noexcept { return default_reclamation_domain(); }
+    pointer_type install_dummy();
+    };
+
+  template<typename T>
+  mailbox_internal_tmpl<T>::~mailbox_internal_tmpl()
+    {
+    pointer_type node { head_.load( std::memory_order_acquire ) };
+    while( node != nullptr )
+      {
+      pointer_type next { node->next.load( std::memory_order_relaxed ) };
+      delete node;
+      node = next;
+      }
+    }
+
+  template<typename T>
+  bool mailbox_internal_tmpl<T>::empty() const noexcept
+    {
+    reclamation_domain_t::guard_t guard{ domain() };
+    pointer_type const head { head_.load( std::memory_order_acquire ) };
+    return head == nullptr || head->next.load( std::memory_order_acquire ) == nullptr;
+    }
+
+  template<typename T>
+  typename mailbox_internal_tmpl<T>::pointer_type
+  mailbox_internal_tmpl<T>::install_dummy()
+    {
+    pointer_type head { head_.load( std::memory_order_acquire ) };
+    if( head == nullptr )
+      {
+      std::unique_ptr<node_type> dummy { std::make_unique<node_type>() };
+      if( head_.compare_exchange_strong( head, dummy.get(), std::memory_order_acq_rel, std::memory_order_acquire ) )
+        head = dummy.release();
+      }
+    // help installer publish tail, head is not retired before tail leaves it
+    pointer_type tail{};
+    tail_.compare_exchange_strong( tail, head, std::memory_order_acq_rel, std::memory_order_acquire );
+    return tail_.load( std::memory_order_acquire );
+    }
+
+  template<typename T>
+  template<typename value_type>
+  void mailbox_internal_tmpl<T>::push( value_type && user_data )
+    {
+    pointer_type const node { new node_type( std::forward<value_type>(user_data) ) };
+    reclamation_domain_t::guard_t guard{ domain() };
+    pointer_type tail { tail_.load( std::memory_order_acquire ) };
+    if( tail == nullptr )
+      tail = install_dummy();
+    for(;;)
+      {
+      pointer_type next { tail->next.load( std::memory_order_acquire ) };
+      if( next == nullptr )
+        {
+        if( tail->next.compare_exchange_weak( next, node, std::memory_order_release, std::memory_order_relaxed ) )
+          break;
+        }
+      else
+        // tail is falling behind, help it
+        tail_.compare_exchange_strong( tail, next, std::memory_order_acq_rel, std::memory_order_acquire );
+      tail = tail_.load( std::memory_order_acquire );
+      }
+    tail_.compare_exchange_strong( tail, node, std::memory_order_acq_rel, std::memory_order_relaxed );
+    }
+
+  template<typename T>
+  bool mailbox_internal_tmpl<T>::pull( user_obj_type & user_data )
+    {
+    reclamation_domain_t::guard_t guard{ domain() };
+    pointer_type head { head_.load( std::memory_order_acquire ) };
+    for(;;)
+      {
+      if( head == nullptr )
+        return false;
+      pointer_type next { head->next.load( std::memory_order_acquire ) };
+      if( next == nullptr )
+        return false;
+      pointer_type tail { tail_.load( std::memory_order_acquire ) };
+      if( head == tail )
+        // tail is falling behind, advance it before head passes it
+        tail_.compare_exchange_strong( tail, next, std::memory_order_acq_rel, std::memory_order_relaxed );
+      else if( head_.compare_exchange_weak( head, next, std::memory_order_acq_rel, std::memory_order_acquire ) )
+        {
+        // next is new dummy, guard keeps it alive and no other consumer reads its value
+        user_data = std::move( next->value );
+        domain().retire( head );
+        return true;
+        }
+      head = head_.load( std::memory_order_acquire );
+      }
+    }
+}
@@ -0,0 +1,125 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// intrusive multi producer single consumer fifo (Dmitry Vyukov)
+// producer links node with single exchange on tail and publishes link from previous node, single consumer walks links
+// from head one node at a time without atomic read-modify-write. Stub node keeps list non empty so consumer never
+// races with producers on head.
+
+#pragma once
+
+#include "common_utils.h"
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // mpsc_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief intrusive mpsc fifo over lifo_node_t nodes, pull must be called from single consumer thread at a time
+  template<typename USER_OBJ_TYPE>
+  class mpsc_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using node_type = lifo_node_t<user_obj_type>;
+    using pointer_type = node_type *;
+    using size_type = long;
+
+  private:
+    alignas(64) std::atomic<pointer_type> tail_;
+    std::atomic<size_type>                pushed_;
+    alignas(64) pointer_type              head_;
+    std::atomic<size_type>                pulled_;
+    node_type                             stub_;
+
+  public:
+    inline bool        empty() const noexcept      { return size() <= 0; }
+    inline size_type   size() const noexcept
+      { return pushed_.load( std::memory_order_acquire ) - pulled_.load( std::memory_order_acquire ); }
+
+  public:
+    mpsc_internal_tmpl() : tail_{ &stub_ }, pushed_{}, head_{ &stub_ }, pulled_{}, stub_{} {}
+    mpsc_internal_tmpl( mpsc_internal_tmpl const & ) = delete;
+    mpsc_internal_tmpl & operator=( mpsc_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief enqueues supplyied node, may be called concurrently from any number of threads
+    void push( node_type * user_data [[gnu::nonnull]] ) noexcept;
+
+    ///\brief dequeues single node in fifo order, consumer side only
+    ///\returns nullptr when queue is empty or when oldest producer did not yet publish its link
+    node_type * pull() noexcept;
+
+  private:
+    void link( node_type * node ) noexcept;
+    };
+
+  template<typename T>
+  void mpsc_internal_tmpl<T>::link( node_type * node ) noexcept
+    {
+    atomic_store( &node->next, pointer_type{}, memorder::relaxed );
+    pointer_type prev { tail_.exchange( node, std::memory_order_acq_rel ) };
+    // between exchange and this store consumer sees end of list at prev
+    atomic_store( &prev->next, node, memorder::release );
+    }
+
+  template<typename T>
+  void mpsc_internal_tmpl<T>::push( node_type * user_data [[gnu::nonnull]] ) noexcept
+    {
+    link( user_data );
+    pushed_.fetch_add( 1, std::memory_order_release );
+    }
+
+  template<typename T>
+  typename mpsc_internal_tmpl<T>::node_type *
+  mpsc_internal_tmpl<T>::pull() noexcept
+    {
+    pointer_type head { head_ };
+    pointer_type next { atomic_load( &head->next, memorder::acquire ) };
+    if( head == &stub_ )
+      {
+      // skip stub
+      if( nullptr == next )
+        return nullptr;
+      head_ = head = next;
+      next = atomic_load( &next->next, memorder::acquire );
+      }
+    if( nullptr == next )
+      {
+      // head is last node or producer is between exchange and link
+      if( head != tail_.load( std::memory_order_acquire ) )
+        return nullptr;
+      // put stub back behind head so head can be detached
+      link( &stub_ );
+      next = atomic_load( &head->next, memorder::acquire );
+      if( nullptr == next )
+        return nullptr;
+      }
+    head_ = next;
+    pulled_.store( pulled_.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+    return head;
+    }
+}
@@ -0,0 +1,244 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// numa aware node sources and socket local queue shards
+// every node gets own huge_page_resource_t region with preferred policy set by mbind, allocation comes from region of
+// node calling thread runs on (getcpu) and deallocation returns block to region it was carved from, so nodes freed
+// by consumer on other socket go back to their home pool. On single node machines or kernels without numa policy
+// support everything degrades to single region.
+
+#pragma once
+
+#include "common_utils.h"
+#include "huge_page_resource.h"
+#include <cstdio>
+#include <vector>
+#include <sched.h>
+
+namespace ampi
+{
+  ///\brief parses sysfs node list like "0" or "0-3" or "0,2-3"
+  ///\returns flags indexed by node id, empty when list is not exposed
+  inline std::vector<bool> read_numa_node_list( char const * path )
+    {
+    // kernel never reports more nodes than MAX_NUMNODES, bound guards against garbage
+    static constexpr unsigned max_nodes = 1u << 16;
+    std::vector<bool> result;
+    if( FILE * file = std::fopen( path, "r" ) )
+      {
+      unsigned first, last;
+      while( std::fscanf( file, "%u", &first ) == 1 )
+        {
+        last = first;
+        int separator { std::fgetc( file ) };
+        if( separator == '-' )
+          {
+          if( std::fscanf( file, "%u", &last ) != 1 )
+            break;
+          separator = std::fgetc( file );
+          }
+        if( first > last || last >= max_nodes )
+          break;
+        if( last >= result.size() )
+          result.resize( last + 1 );
+        for( unsigned node{ first }; node <= last; ++node )
+          result[node] = true;
+        if( separator != ',' )
+          break;
+        }
+      std::fclose( file );
+      }
+    return result;
+    }
+
+  ///\returns highest online numa node plus one, 1 when topology is not exposed
+  ///\description nodes which are only possible (hotplug slots) are not counted, ids of online nodes may have holes
+  inline uint32_t numa_node_count() noexcept
+    {
+    static uint32_t const count { []() noexcept
+      {
+      try
+        {
+        return std::max<uint32_t>( 1, uint32_t( read_numa_node_list( "/sys/devices/system/node/online" ).size() ) );
+        }
+      catch(...)
+        {
+        return uint32_t{1};
+        }
+      }() };
+    return count;
+    }
+
+  ///\returns true when node is online and has memory to bind to, true for every node when kernel does not report it
+  inline bool numa_node_has_memory( uint32_t node ) noexcept
+    {
+    static std::vector<bool> const usable { []() noexcept
+      {
+      try
+        {
+        std::vector<bool> result { read_numa_node_list( "/sys/devices/system/node/has_memory" ) };
+        if( result.empty() )
+          result = read_numa_node_list( "/sys/devices/system/node/online" );
+        return result;
+        }
+      catch(...)
+        {
+        return std::vector<bool>{};
+        }
+      }() };
+    return usable.empty() || ( node < usable.size() && usable[node] );
+    }
+
+  ///\returns numa node of cpu calling thread currently runs on, 0 when unknown
+  inline uint32_t this_numa_node() noexcept
+    {
+    unsigned cpu{}, node{};
+    if( ::getcpu( &cpu, &node ) != 0 || node >= numa_node_count() )
+      return 0;
+    return node;
+    }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // numa_resource_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief memory resource with node local region per numa node, freed blocks return to their home node
+  class numa_resource_t : public std::pmr::memory_resource
+    {
+    std::vector<std::unique_ptr<huge_page_resource_t>> nodes_;
+    bool                                                bound_;
+
+  public:
+    ///\param reserve_bytes_per_node virtual address space reserved for every node region
+    ///\description regions of node ids which are offline or memoryless stay on default policy
+    explicit numa_resource_t( std::size_t reserve_bytes_per_node,
+                              std::pmr::memory_resource * upstream = std::pmr::new_delete_resource() ) :
+        nodes_{},
+        bound_{ true }
+      {
+      uint32_t const count { numa_node_count() };
+      nodes_.reserve( count );
+      for( uint32_t node{}; node != count; ++node )
+        {
+        nodes_.emplace_back( std::make_unique<huge_page_resource_t>( reserve_bytes_per_node, upstream ) );
+        // single node host has nothing to prefer, skip syscall, node without memory can not be preferred
+        if( count > 1 && numa_node_has_memory( node ) )
+          bound_ = nodes_.back()->bind( node ) && bound_;
+        }
+      }
+
+    uint32_t node_count() const noexcept                             { return uint32_t( nodes_.size() ); }
+    ///\returns true when every region of node with memory got its node preference, false on fallback to default policy
+    bool bound() const noexcept                                      { return bound_; }
+    huge_page_resource_t & node_resource( uint32_t node ) noexcept   { return *nodes_[ node % nodes_.size() ]; }
+
+    ///\returns home node of block or node_count() when block came from upstream
+    uint32_t home_node( void const * p ) const noexcept
+      {
+      uint32_t node{};
+      while( node != nodes_.size() && !nodes_[node]->owns( p ) )
+        ++node;
+      return node;
+      }
+
+  protected:
+    void * do_allocate( std::size_t bytes, std::size_t alignment ) override
+      { return node_resource( this_numa_node() ).allocate( bytes, alignment ); }
+
+    void do_deallocate( void * p, std::size_t bytes, std::size_t alignment ) override
+      {
+      // blocks not owned by any region are forwarded to upstream by any node resource
+      uint32_t const node { home_node( p ) };
+      node_resource( node != nodes_.size() ? node : 0 ).deallocate( p, bytes, alignment );
+      }
+
+    bool do_is_equal( std::pmr::memory_resource const & other ) const noexcept override { return this == &other; }
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // numa_sharded_queue_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief one QUEUE shard per numa node with nodes allocated from node local region
+  ///\description @{
+  /// producers push to shard of own node, consumers pull own node shard first and other shards when it is empty.
+  /// QUEUE must be constructible from std::pmr::memory_resource pointer and allow pull from any thread,
+  /// ampi::pmr::fifo_queue_t fits. Ordering is fifo per shard only.
+  ///@}
+  template<typename QUEUE>
+  class numa_sharded_queue_t
+    {
+  public:
+    using queue_type = QUEUE;
+    using user_obj_type = typename queue_type::user_obj_type;
+    using size_type = long;
+
+  private:
+    numa_resource_t                           resource_;
+    std::vector<std::unique_ptr<queue_type>>  shards_;
+
+  public:
+    explicit numa_sharded_queue_t( std::size_t reserve_bytes_per_node = std::size_t{64} << 20 ) :
+        resource_{ reserve_bytes_per_node },
+        shards_{}
+      {
+      shards_.reserve( resource_.node_count() );
+      for( uint32_t node{}; node != resource_.node_count(); ++node )
+        shards_.emplace_back( std::make_unique<queue_type>( &resource_.node_resource( node ) ) );
+      }
+    numa_sharded_queue_t( numa_sharded_queue_t const & ) = delete;
+    numa_sharded_queue_t & operator=( numa_sharded_queue_t const & ) = delete;
+
+    uint32_t          shard_count() const noexcept                { return uint32_t( shards_.size() ); }
+    queue_type &      shard( uint32_t node ) noexcept              { return *shards_[ node % shards_.size() ]; }
+    numa_resource_t & resource() noexcept                          { return resource_; }
+
+    size_type size() const noexcept
+      {
+      size_type result{};
+      for( auto const & shard : shards_ )
+        result += shard->size();
+      return result;
+      }
+    bool empty() const noexcept { return size() <= 0; }
+
+    template<typename value_type>
+    void push( value_type && user_data )
+      { shard( this_numa_node() ).push( std::forward<value_type>(user_data) ); }
+
+    std::pair<user_obj_type,bool> pull()
+      {
+      uint32_t const local { this_numa_node() };
+      for( uint32_t probe{}; probe != shard_count(); ++probe )
+        {
+        auto result { shard( local + probe ).pull() };
+        if( result.second )
+          return result;
+        }
+      return {};
+      }
+    };
+}
@@ -0,0 +1,310 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// object pool with per thread caches in front of shared lifo of batches
+// objects are constructed once and recycled, nodes are returned to the system only when pool is destroyed so pool is
+// type preserving and shared lifo may read link of node popped concurrently. Shared head is pointer_t with 16bit tag
+// against ABA. Caches exchange whole batches with shared lifo, one cas moves batch_size objects.
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+namespace ampi
+{
+  template<typename USER_OBJ_TYPE>
+  struct object_pool_node_t
+    {
+    using user_obj_type = USER_OBJ_TYPE;
+
+    object_pool_node_t *            next;         ///< link inside batch
+    pointer_t<object_pool_node_t>   batch_next;   ///< link between batches in shared lifo
+    uint32_t                        batch_size;
+    user_obj_type                   value;
+
+    template<typename ... args_type>
+    explicit object_pool_node_t( args_type && ... args ) :
+        next{}, batch_next{}, batch_size{}, value( std::forward<args_type>(args)... )
+      {}
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // object_pool_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief lock free pool of reusable objects
+  ///\description @{
+  /// acquire constructs new object only when pool is empty, recycled objects are returned in state they were released.
+  /// Calling thread uses cache slot selected by this_thread_index(), when slot is busy other slots are tried and when
+  /// all are busy shared lifo is used directly. All objects must be released before pool is destroyed.
+  ///@}
+  template<typename USER_OBJ_TYPE>
+  class object_pool_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using node_type = object_pool_node_t<user_obj_type>;
+    using pointer_type = pointer_t<node_type>;
+    using size_type = long;
+
+  private:
+    struct alignas(64) cache_t
+      {
+      std::atomic<bool> busy;
+      node_type *       head;
+      uint32_t          count;
+      };
+
+    alignas(64) pointer_type          shared_;
+    alignas(64) std::atomic<size_type> allocated_;
+    std::unique_ptr<cache_t[]>        caches_;
+    uint32_t                          cache_mask_;
+    uint32_t                          batch_size_;
+
+  public:
+    ///\returns number of objects constructed by pool
+    size_type   allocated() const noexcept        { return allocated_.load( std::memory_order_acquire ); }
+    uint32_t    batch_size() const noexcept       { return batch_size_; }
+
+  public:
+    explicit object_pool_internal_tmpl( uint32_t batch_size = 32, uint32_t cache_count = 16 );
+    ~object_pool_internal_tmpl();
+    object_pool_internal_tmpl( object_pool_internal_tmpl const & ) = delete;
+    object_pool_internal_tmpl & operator=( object_pool_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief pre populates pool with count objects constructed from args
+    template<typename ... args_type>
+    void reserve( size_type count, args_type const & ... args );
+
+    ///\brief takes object from pool or constructs new one from args when pool is empty
+    template<typename ... args_type>
+    node_type * acquire( args_type && ... args );
+
+    ///\brief returns object to pool
+    void release( node_type * node [[gnu::nonnull]] ) noexcept;
+
+    ///\brief moves objects from all thread caches to shared lifo
+    void flush() noexcept;
+
+  private:
+    cache_t * lock_cache() noexcept;
+    void push_batch( node_type * first, uint32_t count ) noexcept;
+    node_type * pull_batch() noexcept;
+    static size_type delete_chain( node_type * node ) noexcept;
+    };
+
+  template<typename T>
+  object_pool_internal_tmpl<T>::object_pool_internal_tmpl( uint32_t batch_size, uint32_t cache_count ) :
+      shared_{},
+      allocated_{},
+      caches_{},
+      cache_mask_{},
+      batch_size_{ batch_size != 0 ? batch_size : 1 }
+    {
+    uint32_t slots{ 1 };
+    while( slots < cache_count )
+      slots <<= 1;
+    cache_mask_ = slots - 1;
+    caches_.reset( new cache_t[slots] );
+    for( uint32_t index{}; index != slots; ++index )
+      {
+      caches_[index].busy.store( false, std::memory_order_relaxed );
+      caches_[index].head = nullptr;
+      caches_[index].count = 0;
+      }
+    }
+
+  template<typename T>
+  object_pool_internal_tmpl<T>::~object_pool_internal_tmpl()
+    {
+    size_type deleted{};
+    for( uint32_t index{}; index <= cache_mask_; ++index )
+      deleted += delete_chain( caches_[index].head );
+    while( node_type * batch = pull_batch() )
+      deleted += delete_chain( batch );
+    assert( deleted == allocated() && "objects must be released before pool is destroyed" );
+    (void)deleted;
+    }
+
+  template<typename T>
+  typename object_pool_internal_tmpl<T>::size_type
+  object_pool_internal_tmpl<T>::delete_chain( node_type * node ) noexcept
+    {
+    size_type count{};
+    while( node != nullptr )
+      {
+      node_type * next { node->next };
+      delete node;
+      node = next;
+      ++count;
+      }
+    return count;
+    }
+
+  template<typename T>
+  typename object_pool_internal_tmpl<T>::cache_t *
+  object_pool_internal_tmpl<T>::lock_cache() noexcept
+    {
+    uint32_t const start { this_thread_index() };
+    for( uint32_t probe{}; probe <= cache_mask_; ++probe )
+      {
+      cache_t & cache { caches_[ ( start + probe ) & cache_mask_ ] };
+      if( !cache.busy.load( std::memory_order_relaxed ) && !cache.busy.exchange( true, std::memory_order_acquire ) )
+        return &cache;
+      }
+    return nullptr;
+    }
+
+  template<typename T>
+  void object_pool_internal_tmpl<T>::push_batch( node_type * first, uint32_t count ) noexcept
+    {
+    first->batch_size = count;
+    pointer_type head;
+    do
+      {
+      head = atomic_load( shared_, memorder::acquire );
+      // stale reader may load batch_next of node it does not own, its cas fails on changed tag
+      __atomic_store_n( &first->batch_next.cas_value, pointer_type{ head.get() }.cas_value, __ATOMIC_RELAXED );
+      }
+    while( !cas( shared_, head, first, head.count() + 1 ) );
+    }
+
+  template<typename T>
+  typename object_pool_internal_tmpl<T>::node_type *
+  object_pool_internal_tmpl<T>::pull_batch() noexcept
+    {
+    pointer_type head { atomic_load( shared_, memorder::acquire ) };
+    while( head )
+      {
+      // nodes are never freed while pool exists so reading link of concurrently popped node is safe
+      pointer_type const next { atomic_load( head->batch_next, memorder::acquire ) };
+      if( cas( shared_, head, next.get(), head.count() + 1 ) )
+        return head.get();
+      head = atomic_load( shared_, memorder::acquire );
+      }
+    return nullptr;
+    }
+
+  template<typename T>
+  template<typename ... args_type>
+  void object_pool_internal_tmpl<T>::reserve( size_type count, args_type const & ... args )
+    {
+    while( count > 0 )
+      {
+      uint32_t const batch { uint32_t( std::min<size_type>( count, batch_size_ ) ) };
+      node_type * first{};
+      for( uint32_t index{}; index != batch; ++index )
+        {
+        node_type * node { new node_type( args... ) };
+        allocated_.fetch_add( size_type{1}, std::memory_order_relaxed );
+        node->next = first;
+        first = node;
+        }
+      push_batch( first, batch );
+      count -= batch;
+      }
+    }
+
+  template<typename T>
+  template<typename ... args_type>
+  typename object_pool_internal_tmpl<T>::node_type *
+  object_pool_internal_tmpl<T>::acquire( args_type && ... args )
+    {
+    node_type * node{};
+    if( cache_t * cache = lock_cache() )
+      {
+      if( cache->head == nullptr )
+        {
+        // refill whole batch with single cas
+        cache->head = pull_batch();
+        cache->count = cache->head != nullptr ? cache->head->batch_size : 0;
+        }
+      node = cache->head;
+      if( node != nullptr )
+        {
+        cache->head = node->next;
+        --cache->count;
+        }
+      cache->busy.store( false, std::memory_order_release );
+      }
+    else if( ( node = pull_batch() ) != nullptr && node->next != nullptr )
+      // no cache available, keep first object and give back rest of batch
+      push_batch( node->next, node->batch_size - 1 );
+
+    if( node == nullptr )
+      {
+      node = new node_type( std::forward<args_type>(args)... );
+      allocated_.fetch_add( size_type{1}, std::memory_order_relaxed );
+      }
+    node->next = nullptr;
+    return node;
+    }
+
+  template<typename T>
+  void object_pool_internal_tmpl<T>::release( node_type * node [[gnu::nonnull]] ) noexcept
+    {
+    cache_t * cache { lock_cache() };
+    if( cache == nullptr )
+      {
+      node->next = nullptr;
+      push_batch( node, 1 );
+      return;
+      }
+    node->next = cache->head;
+    cache->head = node;
+    if( ++cache->count >= 2 * batch_size_ )
+      {
+      // keep recently released objects hot in cache, flush older ones as single batch
+      node_type * cut { cache->head };
+      for( uint32_t index{1}; index != batch_size_; ++index )
+        cut = cut->next;
+      node_type * const tail { cut->next };
+      cut->next = nullptr;
+      push_batch( tail, cache->count - batch_size_ );
+      cache->count = batch_size_;
+      }
+    cache->busy.store( false, std::memory_order_release );
+    }
+
+  template<typename T>
+  void object_pool_internal_tmpl<T>::flush() noexcept
+    {
+    for( uint32_t index{}; index <= cache_mask_; ++index )
+      {
+      cache_t & cache { caches_[index] };
+      while( cache.busy.exchange( true, std::memory_order_acquire ) )
+        std::this_thread::yield();
+      if( cache.head != nullptr )
+        push_batch( cache.head, cache.count );
+      cache.head = nullptr;
+      cache.count = 0;
+      cache.busy.store( false, std::memory_order_release );
+      }
+    }
+}
@@ -0,0 +1,149 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// key partitioned queue, key hash selects one of N QUEUE partitions so all elements of one key share partition and
+// keep producer order. Partition is drained by at most one consumer at a time, consumer leases partition with try lock
+// for whole batch so per key order holds also when idle consumer steals partition of busy or absent owner.
+
+#pragma once
+
+#include "common_utils.h"
+#include <functional>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // partitioned_queue_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief QUEUE partitions selected by key hash, consumer c owns partitions c, c + consumer_count, ...
+  ///\description @{
+  /// QUEUE must allow push from any thread and pull returning std::pair<user_obj_type,bool>, ampi::fifo_queue_t fits.
+  /// Elements are handed to consumer function under partition lease so processing of one key is never concurrent.
+  ///@}
+  template<typename KEY_TYPE, typename QUEUE, typename HASH = std::hash<KEY_TYPE>>
+  class partitioned_queue_tmpl
+    {
+  public:
+    using key_type = KEY_TYPE;
+    using queue_type = QUEUE;
+    using user_obj_type = typename queue_type::user_obj_type;
+    using size_type = long;
+    static constexpr std::size_t cache_line_size = 64;
+
+  private:
+    struct alignas(cache_line_size) partition_t
+      {
+      queue_type            queue;
+      std::atomic<uint32_t> leased{};
+      };
+
+    struct lease_t
+      {
+      partition_t & partition;
+      ~lease_t() { partition.leased.store( 0, std::memory_order_release ); }
+      };
+
+    std::unique_ptr<partition_t[]> partitions_;
+    uint32_t                       partition_count_;
+    uint32_t                       consumer_count_;
+    bool                           steal_;
+    HASH                           hash_;
+
+  public:
+    uint32_t      partition_count() const noexcept           { return partition_count_; }
+    uint32_t      consumer_count() const noexcept            { return consumer_count_; }
+    queue_type &  partition( uint32_t index ) noexcept       { return partitions_[index].queue; }
+    uint32_t      partition_of( key_type const & key ) const { return uint32_t( hash_( key ) % partition_count_ ); }
+
+    size_type size() const noexcept
+      {
+      size_type result{};
+      for( uint32_t index{}; index != partition_count_; ++index )
+        result += partitions_[index].queue.size();
+      return result;
+      }
+    bool empty() const noexcept { return size() <= 0; }
+
+  public:
+    ///\param partition_count number of partitions, at least consumer_count for every consumer to own one
+    ///\param steal allow consumer with no work in own partitions to lease idle partition of other consumer
+    partitioned_queue_tmpl( uint32_t partition_count, uint32_t consumer_count, bool steal = true, HASH const & hash = HASH{} ) :
+        partitions_{ new partition_t[ partition_count ] },
+        partition_count_{ partition_count },
+        consumer_count_{ consumer_count },
+        steal_{ steal },
+        hash_{ hash }
+      { assert( partition_count != 0 && consumer_count != 0 ); }
+    partitioned_queue_tmpl( partitioned_queue_tmpl const & ) = delete;
+    partitioned_queue_tmpl & operator=( partitioned_queue_tmpl const & ) = delete;
+
+    template<typename value_type>
+    void push( key_type const & key, value_type && user_data )
+      { partitions_[ partition_of( key ) ].queue.push( std::forward<value_type>(user_data) ); }
+
+    ///\brief drains up to max_batch elements from each partition owned by consumer passing them to fn( user_obj_type && ),
+    /// when they are all empty and stealing is enabled drains first other partition with work that is not leased
+    ///\returns number of consumed elements
+    template<typename function_type>
+    size_type consume( uint32_t consumer, function_type && fn, size_type max_batch = 64 )
+      {
+      assert( consumer < consumer_count_ );
+      size_type result{};
+      for( uint32_t index{ consumer }; index < partition_count_; index += consumer_count_ )
+        result += drain( index, fn, max_batch );
+      if( result == 0 && steal_ )
+        for( uint32_t probe{ 1 }; probe != partition_count_ && result == 0; ++probe )
+          {
+          uint32_t const index { ( consumer + probe ) % partition_count_ };
+          if( index % consumer_count_ != consumer && !partitions_[index].queue.empty() )
+            result = drain( index, fn, max_batch );
+          }
+      return result;
+      }
+
+  private:
+    template<typename function_type>
+    size_type drain( uint32_t index, function_type & fn, size_type max_batch )
+      {
+      partition_t & partition { partitions_[index] };
+      uint32_t free_partition{};
+      // partition leased by other consumer is skipped, it is drained by lease holder
+      if( partition.leased.load( std::memory_order_relaxed ) != 0
+          || !partition.leased.compare_exchange_strong( free_partition, 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+        return 0;
+      lease_t lease{ partition };
+      size_type result{};
+      for( ; result != max_batch; ++result )
+        {
+        auto element { partition.queue.pull() };
+        if( !element.second )
+          break;
+        fn( std::move( element.first ) );
+        }
+      return result;
+      }
+    };
+}
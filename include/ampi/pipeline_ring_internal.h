@@ -0,0 +1,207 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// pipeline ring with sequence barriers (disruptor style)
+// producer claims batch of sequences, fills cells in place and publishes them by moving its cursor. Every stage has own
+// cursor and processes cells in place once all its upstream cursors passed them, so multi stage flow has single ring and
+// no copies between stages. Producer is gated by slowest stage. Stages are configured before producer starts.
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // pipeline_ring_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class pipeline_ring_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using sequence_type = uint64_t;
+    static constexpr int producer = -1;
+
+  private:
+    struct alignas(64) stage_t
+      {
+      // next sequence to process
+      std::atomic<sequence_type> cursor;
+      std::vector<int>           upstream;
+      };
+
+    alignas(64) std::atomic<sequence_type> published_;
+    alignas(64) sequence_type              claimed_;
+    sequence_type                          gating_;
+    std::unique_ptr<user_obj_type[]>       cells_;
+    std::unique_ptr<stage_t[]>             stages_;
+    sequence_type                          mask_;
+    uint32_t                               max_stages_;
+    uint32_t                               stage_count_;
+
+  public:
+    uint64_t capacity() const noexcept { return mask_ + 1; }
+    uint32_t stage_count() const noexcept { return stage_count_; }
+
+  public:
+    ///\param capacity is rounded up to power of 2
+    pipeline_ring_internal_tmpl( uint64_t capacity, uint32_t max_stages );
+    pipeline_ring_internal_tmpl( pipeline_ring_internal_tmpl const & ) = delete;
+    pipeline_ring_internal_tmpl & operator=( pipeline_ring_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief adds stage processing cells after all upstream stages, producer means directly after publishing
+    /// and is also taken for empty upstream list
+    ///\returns stage id
+    int add_stage( std::initializer_list<int> upstream = { producer } );
+
+    ///\brief single producer claims count consecutive cells, waits while slowest stage is full ring behind
+    ///\returns first claimed sequence
+    sequence_type claim( sequence_type count = 1 ) noexcept;
+
+    ///\brief makes claimed cells up to sequence + count visible to stages
+    void publish( sequence_type sequence, sequence_type count = 1 ) noexcept;
+
+    user_obj_type & operator[]( sequence_type sequence ) noexcept { return cells_[sequence & mask_]; }
+
+    ///\returns sequence up to which stage may process
+    sequence_type available( int stage ) const noexcept;
+
+    ///\brief calls fn( value, sequence ) in place for available cells and advances stage cursor once
+    ///\returns number of processed cells
+    template<typename function>
+    sequence_type process( int stage, function const & fn, sequence_type max_batch = std::numeric_limits<sequence_type>::max() );
+
+  private:
+    sequence_type cursor_of( int stage ) const noexcept;
+    sequence_type min_stage_cursor() const noexcept;
+    };
+
+  template<typename T>
+  pipeline_ring_internal_tmpl<T>::pipeline_ring_internal_tmpl( uint64_t capacity, uint32_t max_stages ) :
+      published_{}, claimed_{}, gating_{}, mask_{}, max_stages_{ max_stages }, stage_count_{}
+    {
+    uint64_t size { 2 };
+    while( size < capacity )
+      size <<= 1;
+    mask_ = size - 1;
+    cells_ = std::make_unique<user_obj_type[]>( size );
+    stages_ = std::make_unique<stage_t[]>( max_stages );
+    }
+
+  template<typename T>
+  int pipeline_ring_internal_tmpl<T>::add_stage( std::initializer_list<int> upstream )
+    {
+    assert( stage_count_ != max_stages_ );
+    int const stage { static_cast<int>( stage_count_ ) };
+    for( int dependency : upstream )
+      {
+      assert( dependency == producer || (dependency >= 0 && dependency < stage) );
+      stages_[stage].upstream.push_back( dependency );
+      }
+    // stage without dependency would see unpublished cells as available
+    if( stages_[stage].upstream.empty() )
+      stages_[stage].upstream.push_back( producer );
+    stages_[stage].cursor.store( published_.load( std::memory_order_relaxed ), std::memory_order_release );
+    ++stage_count_;
+    return stage;
+    }
+
+  template<typename T>
+  typename pipeline_ring_internal_tmpl<T>::sequence_type
+  pipeline_ring_internal_tmpl<T>::cursor_of( int stage ) const noexcept
+    {
+    return stage == producer ? published_.load( std::memory_order_acquire )
+                             : stages_[stage].cursor.load( std::memory_order_acquire );
+    }
+
+  template<typename T>
+  typename pipeline_ring_internal_tmpl<T>::sequence_type
+  pipeline_ring_internal_tmpl<T>::min_stage_cursor() const noexcept
+    {
+    sequence_type result { claimed_ };
+    for( uint32_t stage{}; stage != stage_count_; ++stage )
+      result = std::min( result, stages_[stage].cursor.load( std::memory_order_acquire ) );
+    return result;
+    }
+
+  template<typename T>
+  typename pipeline_ring_internal_tmpl<T>::sequence_type
+  pipeline_ring_internal_tmpl<T>::claim( sequence_type count ) noexcept
+    {
+    assert( count <= capacity() );
+    sequence_type const first { claimed_ };
+    sequence_type const end { first + count };
+    // cached slowest cursor is recomputed only when it blocks claim
+    while( end > gating_ + capacity() )
+      {
+      gating_ = min_stage_cursor();
+      if( end <= gating_ + capacity() )
+        break;
+      std::this_thread::yield();
+      }
+    claimed_ = end;
+    return first;
+    }
+
+  template<typename T>
+  void pipeline_ring_internal_tmpl<T>::publish( sequence_type sequence, sequence_type count ) noexcept
+    {
+    published_.store( sequence + count, std::memory_order_release );
+    }
+
+  template<typename T>
+  typename pipeline_ring_internal_tmpl<T>::sequence_type
+  pipeline_ring_internal_tmpl<T>::available( int stage ) const noexcept
+    {
+    sequence_type result { std::numeric_limits<sequence_type>::max() };
+    for( int dependency : stages_[stage].upstream )
+      result = std::min( result, cursor_of( dependency ) );
+    return result;
+    }
+
+  template<typename T>
+  template<typename function>
+  typename pipeline_ring_internal_tmpl<T>::sequence_type
+  pipeline_ring_internal_tmpl<T>::process( int stage, function const & fn, sequence_type max_batch )
+    {
+    std::atomic<sequence_type> & cursor { stages_[stage].cursor };
+    sequence_type const first { cursor.load( std::memory_order_relaxed ) };
+    sequence_type const end { first + std::min( available( stage ) - first, max_batch ) };
+    for( sequence_type sequence { first }; sequence != end; ++sequence )
+      fn( cells_[sequence & mask_], sequence );
+    if( end != first )
+      cursor.store( end, std::memory_order_release );
+    return end - first;
+    }
+}
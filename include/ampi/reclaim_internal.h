@@ -0,0 +1,217 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// epoch based reclamation domain
+// threads access shared nodes inside guard which announces global epoch observed at entry in one of domain slots,
+// retired node is stamped with epoch and advances global epoch, it is freed when every announced epoch is newer.
+// retired nodes are kept in aggregated pop queue afifo_internal_tmpl so reclaiming thread detaches all of them with single
+// exchange. Stalled thread inside guard delays reclamation but never makes it unsafe.
+
+#pragma once
+
+#include "common_utils.h"
+#include "afifo_internal.h"
+#include <array>
+#include <limits>
+#include <thread>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // reclamation_domain_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  class reclamation_domain_t
+    {
+  public:
+    using epoch_type = uint64_t;
+    using deleter_type = void (*)( void * );
+    static constexpr uint32_t slot_count = 256;
+    static constexpr uint32_t reclaim_threshold = 64;
+
+    struct retired_t
+      {
+      void *       pointer;
+      deleter_type deleter;
+      epoch_type   epoch;
+      bool         embedded {};   // record lives inside retired object and is freed by deleter
+      };
+    using retired_list_type = afifo_internal_tmpl<retired_t>;
+    using retired_node_type = retired_list_type::node_type;
+
+  private:
+    struct alignas(64) slot_t
+      {
+      std::atomic<epoch_type> epoch;
+      };
+
+    alignas(64) std::atomic<epoch_type>  epoch_;
+    alignas(64) std::atomic<uint32_t>    retire_count_;
+    retired_list_type                    retired_;
+    std::array<slot_t,slot_count>        slots_;
+
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    ///\brief RAII critical section, nodes loaded from shared structure inside guard are not freed until guard ends
+    class guard_t
+      {
+      slot_t * slot_;
+
+    public:
+      explicit guard_t( reclamation_domain_t & domain ) noexcept : slot_{ domain.enter() } {}
+      guard_t( guard_t const & ) = delete;
+      guard_t & operator=( guard_t const & ) = delete;
+      ~guard_t() { slot_->epoch.store( 0, std::memory_order_release ); }
+      };
+
+  public:
+    reclamation_domain_t() noexcept;
+    ~reclamation_domain_t();
+    reclamation_domain_t( reclamation_domain_t const & ) = delete;
+    reclamation_domain_t & operator=( reclamation_domain_t const & ) = delete;
+
+    ///\brief defers deletion of already unlinked node until no guard can reference it
+    void retire( void * pointer, deleter_type deleter );
+
+    template<typename node_type>
+    void retire( node_type * node )
+      { retire( node, []( void * pointer ){ delete static_cast<node_type *>( pointer ); } ); }
+
+    ///\brief non throwing retire with record embedded in retired object, deleter frees record together with object
+    void retire( retired_node_type * record, void * pointer, deleter_type deleter ) noexcept;
+
+    ///\brief frees retired nodes which are not protected by any guard
+    void reclaim() noexcept;
+
+  private:
+    static void release( retired_node_type * node ) noexcept;
+    slot_t * enter() noexcept;
+    epoch_type oldest_announced() const noexcept;
+    };
+
+  ///\returns domain shared by containers which are not given own domain
+  inline reclamation_domain_t & default_reclamation_domain() noexcept
+    {
+    static reclamation_domain_t domain;
+    return domain;
+    }
+
+  inline reclamation_domain_t::reclamation_domain_t() noexcept :
+      epoch_{ 1 },
+      retire_count_{},
+      retired_{},
+      slots_{}
+    {
+    for( slot_t & slot : slots_ )
+      slot.epoch.store( 0, std::memory_order_relaxed );
+    }
+
+  inline reclamation_domain_t::~reclamation_domain_t()
+    {
+    auto retired { retired_.drain() };
+    while( retired_node_type * node = retired.pull() )
+      release( node );
+    }
+
+  inline void reclamation_domain_t::release( retired_node_type * node ) noexcept
+    {
+    bool const embedded { node->value.embedded };
+    node->value.deleter( node->value.pointer );
+    if( !embedded )
+      delete node;
+    }
+
+  inline reclamation_domain_t::slot_t * reclamation_domain_t::enter() noexcept
+    {
+    uint32_t const start { this_thread_index() };
+    for(;;)
+      {
+      for( uint32_t step{}; step != slot_count; ++step )
+        {
+        slot_t & slot { slots_[ (start + step) % slot_count ] };
+        epoch_type free_slot{};
+        epoch_type epoch { epoch_.load( std::memory_order_seq_cst ) };
+        if( slot.epoch.compare_exchange_strong( free_slot, epoch, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+          {
+          // announce must be visible before global epoch read that protects later loads
+          for( epoch_type current{ epoch_.load( std::memory_order_seq_cst ) }; current != epoch; current = epoch_.load( std::memory_order_seq_cst ) )
+            {
+            epoch = current;
+            slot.epoch.store( epoch, std::memory_order_seq_cst );
+            }
+          return &slot;
+          }
+        }
+      // more concurrent guards than slots
+      std::this_thread::yield();
+      }
+    }
+
+  inline reclamation_domain_t::epoch_type reclamation_domain_t::oldest_announced() const noexcept
+    {
+    epoch_type result { std::numeric_limits<epoch_type>::max() };
+    for( slot_t const & slot : slots_ )
+      {
+      epoch_type const epoch { slot.epoch.load( std::memory_order_seq_cst ) };
+      if( epoch != 0 && epoch < result )
+        result = epoch;
+      }
+    return result;
+    }
+
+  inline void reclamation_domain_t::retire( void * pointer, deleter_type deleter )
+    {
+    std::unique_ptr<retired_node_type> node { std::make_unique<retired_node_type>() };
+    node->value = retired_t{ pointer, deleter, epoch_.fetch_add( 1, std::memory_order_seq_cst ) };
+    retired_.push( node.release() );
+    if( retire_count_.fetch_add( 1, std::memory_order_relaxed ) % reclaim_threshold == reclaim_threshold - 1 )
+      reclaim();
+    }
+
+  inline void reclamation_domain_t::retire( retired_node_type * record, void * pointer, deleter_type deleter ) noexcept
+    {
+    record->value = retired_t{ pointer, deleter, epoch_.fetch_add( 1, std::memory_order_seq_cst ), true };
+    retired_.push( record );
+    if( retire_count_.fetch_add( 1, std::memory_order_relaxed ) % reclaim_threshold == reclaim_threshold - 1 )
+      reclaim();
+    }
+
+  inline void reclamation_domain_t::reclaim() noexcept
+    {
+    // order of retired records does not matter, drain avoids reversal pass
+    auto retired { retired_.drain() };
+    if( retired.empty() )
+      return;
+    epoch_type const oldest { oldest_announced() };
+    while( retired_node_type * node = retired.pull() )
+      {
+      if( node->value.epoch < oldest )
+        release( node );
+      else
+        // still may be referenced, give it back
+        retired_.push( node );
+      }
+    }
+}
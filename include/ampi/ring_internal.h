@@ -0,0 +1,196 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// bounded mpmc ring with per cell sequence numbers (Dmitry Vyukov)
+// cells are placed right after ring header, there are no pointers inside so ring is relocatable and may be placed in
+// memory shared between processes
+
+#pragma once
+
+#include "common_utils.h"
+#include <type_traits>
+#include <new>
+
+namespace ampi
+{
+  template<typename USER_OBJ_TYPE>
+  struct ring_cell_t
+    {
+    using user_obj_type = USER_OBJ_TYPE;
+
+    uint64_t       sequence;
+    user_obj_type  value;
+
+    explicit ring_cell_t( uint64_t seq ) : sequence{ seq }, value{} {}
+    };
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // ring_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief bounded mpmc ring with cells following ring header
+  ///\description @{
+  /// object must be constructed with placement new in memory of storage_size(capacity) bytes aligned to cache line,
+  /// capacity is rounded up to power of 2
+  ///@}
+  template<typename USER_OBJ_TYPE>
+  class alignas(64) ring_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using cell_type = ring_cell_t<user_obj_type>;
+    using size_type = long;
+    static constexpr std::size_t cache_line_size = 64;
+    ///\brief largest capacity whose rounded storage fits 48bit address space
+    static constexpr uint64_t max_capacity = ( uint64_t{1} << 47 ) / sizeof(cell_type);
+
+  private:
+    alignas(cache_line_size) uint64_t enqueue_pos_;
+    alignas(cache_line_size) uint64_t dequeue_pos_;
+    alignas(cache_line_size) uint64_t mask_;
+
+  public:
+    static constexpr uint64_t round_capacity( uint64_t capacity ) noexcept
+      {
+      uint64_t result{ 2 };
+      while( result < capacity )
+        result <<= 1;
+      return result;
+      }
+    ///\returns number of bytes required for ring header and cells
+    static constexpr std::size_t storage_size( uint64_t capacity ) noexcept
+      { return sizeof(ring_internal_tmpl) + round_capacity( capacity ) * sizeof(cell_type); }
+
+    size_type  size() const noexcept;
+    bool       empty() const noexcept                  { return size() == 0; }
+    uint64_t   capacity() const noexcept               { return mask_ + 1; }
+
+  public:
+    explicit ring_internal_tmpl( uint64_t capacity );
+    ~ring_internal_tmpl();
+    ring_internal_tmpl( ring_internal_tmpl const & ) = delete;
+    ring_internal_tmpl & operator=( ring_internal_tmpl const & ) = delete;
+
+  public:
+    ///\returns false when ring is full
+    template<typename value_type>
+    bool push( value_type && user_data );
+
+    ///\returns false when ring is empty
+    bool pull( user_obj_type & user_data );
+
+  private:
+    cell_type & cell_at( uint64_t pos ) noexcept
+      { return reinterpret_cast<cell_type *>( this + 1 )[pos & mask_]; }
+    cell_type const & cell_at( uint64_t pos ) const noexcept
+      { return reinterpret_cast<cell_type const *>( this + 1 )[pos & mask_]; }
+    };
+
+  template<typename T>
+  ring_internal_tmpl<T>::ring_internal_tmpl( uint64_t capacity ) :
+      enqueue_pos_{},
+      dequeue_pos_{},
+      mask_{ round_capacity( capacity ) - 1 }
+    {
+    static_assert( sizeof(ring_internal_tmpl) % alignof(cell_type) == 0, "cells must be aligned" );
+    for( uint64_t pos{}; pos <= mask_; ++pos )
+      new (&cell_at(pos)) cell_type( pos );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    }
+
+  template<typename T>
+  ring_internal_tmpl<T>::~ring_internal_tmpl()
+    {
+    for( uint64_t pos{}; pos <= mask_; ++pos )
+      cell_at(pos).~cell_type();
+    }
+
+  template<typename T>
+  typename ring_internal_tmpl<T>::size_type
+  ring_internal_tmpl<T>::size() const noexcept
+    {
+    uint64_t const deq { atomic_load( const_cast<uint64_t *>(&dequeue_pos_), memorder::acquire ) };
+    uint64_t const enq { atomic_load( const_cast<uint64_t *>(&enqueue_pos_), memorder::acquire ) };
+    return enq > deq ? static_cast<size_type>( enq - deq ) : 0;
+    }
+
+  template<typename T>
+  template<typename value_type>
+  bool ring_internal_tmpl<T>::push( value_type && user_data )
+    {
+    uint64_t pos { atomic_load( &enqueue_pos_, memorder::relaxed ) };
+    cell_type * cell;
+    for(;;)
+      {
+      cell = &cell_at( pos );
+      uint64_t const seq { atomic_load( &cell->sequence, memorder::acquire ) };
+      int64_t const diff { static_cast<int64_t>( seq - pos ) };
+      // cell is free for this position, try to claim it
+      if( diff == 0 )
+        {
+        if( atomic_compare_exchange( &enqueue_pos_, pos, pos + 1, memorder::relaxed, memorder::relaxed ) )
+          break;
+        pos = atomic_load( &enqueue_pos_, memorder::relaxed );
+        }
+      // cell is still occupied by value from previous lap, ring is full
+      else if( diff < 0 )
+        return false;
+      else
+        pos = atomic_load( &enqueue_pos_, memorder::relaxed );
+      }
+    cell->value = std::forward<value_type>( user_data );
+    atomic_store( &cell->sequence, pos + 1, memorder::release );
+    return true;
+    }
+
+  template<typename T>
+  bool ring_internal_tmpl<T>::pull( user_obj_type & user_data )
+    {
+    uint64_t pos { atomic_load( &dequeue_pos_, memorder::relaxed ) };
+    cell_type * cell;
+    for(;;)
+      {
+      cell = &cell_at( pos );
+      uint64_t const seq { atomic_load( &cell->sequence, memorder::acquire ) };
+      int64_t const diff { static_cast<int64_t>( seq - (pos + 1) ) };
+      // cell is published for this position, try to claim it
+      if( diff == 0 )
+        {
+        if( atomic_compare_exchange( &dequeue_pos_, pos, pos + 1, memorder::relaxed, memorder::relaxed ) )
+          break;
+        pos = atomic_load( &dequeue_pos_, memorder::relaxed );
+        }
+      // cell was not yet written, ring is empty
+      else if( diff < 0 )
+        return false;
+      else
+        pos = atomic_load( &dequeue_pos_, memorder::relaxed );
+      }
+    user_data = std::move( cell->value );
+    // release cell for next lap
+    atomic_store( &cell->sequence, pos + mask_ + 1, memorder::release );
+    return true;
+    }
+}
@@ -0,0 +1,92 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// wait on any of several queues
+// queues which wake consumers are wrapped in notifying_queue_t sharing one eventcount_t, producer after push only checks
+// for present waiters, consumer blocks in select until any of the queues becomes non empty.
+
+#pragma once
+
+#include "eventcount.h"
+#include <utility>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // notifying_queue_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief queue which notifies shared eventcount after every push
+  template<typename QUEUE_TYPE>
+  class notifying_queue_t
+      : public QUEUE_TYPE
+    {
+  public:
+    using base_type = QUEUE_TYPE;
+
+  private:
+    eventcount_t & eventcount_;
+
+  public:
+    template<typename ... arg_types>
+    explicit notifying_queue_t( eventcount_t & eventcount, arg_types && ... args ) :
+        base_type( std::forward<arg_types>(args)... ), eventcount_{ eventcount }
+      {}
+
+    eventcount_t & eventcount() const noexcept { return eventcount_; }
+
+    template<typename ... arg_types>
+    auto push( arg_types && ... args ) -> decltype( std::declval<base_type &>().push( std::forward<arg_types>(args)... ) )
+      {
+      notify_on_exit_t<eventcount_t> const notify { eventcount_ };
+      return base_type::push( std::forward<arg_types>(args)... );
+      }
+    };
+
+  ///\returns index of first non empty queue or -1
+  template<typename ... queue_types>
+  inline int first_non_empty( queue_types const & ... queues ) noexcept
+    {
+    int result { -1 };
+    int index {};
+    ( ( result < 0 && !queues.empty() ? result = index : 0, ++index ), ... );
+    return result;
+    }
+
+  ///\brief blocks until any of queues is non empty
+  ///\description @{
+  /// queues must be pushed through notifying_queue_t using the same eventcount, when several queues are non empty the
+  /// one earlier on the list is reported so order of arguments gives priority
+  ///@}
+  ///\param timeout_ms relative timeout of whole wait, negative value waits infinitely
+  ///\returns index of non empty queue or -1 on timeout
+  template<typename ... queue_types>
+  inline int select( eventcount_t & eventcount, long timeout_ms, queue_types const & ... queues )
+    {
+    int ready { -1 };
+    wait_for( eventcount, timeout_ms, [&]{ ready = first_non_empty( queues... ); return ready >= 0; } );
+    return ready;
+    }
+}
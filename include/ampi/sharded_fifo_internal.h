@@ -0,0 +1,185 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// relaxed fifo, multi queue of fifo_queue_internal_tmpl shards
+// pushes are thread affine, each thread always pushes to the same shard so order of elements pushed by single
+// thread is strict fifo. Pulls use power of two choices, from two random shards the one with more elements is pulled.
+// Order between elements pushed by different threads is relaxed, for N shards expected rank error of pulled element
+// (number of elements pushed before it that are still queued) is O(N) and it never exceeds number of elements queued
+// in other shards.
+
+#pragma once
+
+#include "fifo_internal.h"
+#include <thread>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // sharded_fifo_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE, typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class sharded_fifo_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using allocator_type = ALLOCATOR;
+    using shard_queue_type = fifo_queue_internal_tmpl<user_obj_type,allocator_type>;
+    using size_type = typename shard_queue_type::size_type;
+
+  private:
+    struct alignas(64) shard_t
+      {
+      shard_queue_type queue;
+
+      explicit shard_t( allocator_type const & allocator ) : queue{ allocator } {}
+      };
+    using shard_traits = node_allocator_traits<shard_t,allocator_type>;
+
+    allocator_type             allocator_;
+    uint32_t                   mask_;
+    shard_t *                  shards_;
+
+  public:
+    ///\brief checks all shards
+    bool        empty() const noexcept;
+    ///\brief sum of all shard sizes
+    size_type   size() const  noexcept;
+    uint32_t    shard_count() const noexcept      { return mask_ + 1; }
+    allocator_type get_allocator() const noexcept { return allocator_; }
+
+  public:
+    ///\param shard_count number of shards, rounded up to power of 2, 0 selects twice the hardware concurrency
+    ///\param allocator shard array, shard nodes and envelopes of public wrapper come from it
+    explicit sharded_fifo_internal_tmpl( uint32_t shard_count = 0, allocator_type const & allocator = allocator_type{} );
+    ~sharded_fifo_internal_tmpl();
+    sharded_fifo_internal_tmpl( sharded_fifo_internal_tmpl const & ) = delete;
+    sharded_fifo_internal_tmpl & operator=( sharded_fifo_internal_tmpl const & ) = delete;
+
+  public:
+    ///\brief enqueues to shard of calling thread
+    void push( user_obj_type * user_data );
+
+    ///\brief dequeues from larger of two random shards, falls back to scan of all shards
+    ///\returns nullptr only when all shards were empty during scan
+    user_obj_type * pull();
+
+  private:
+    static uint32_t round_shard_count( uint32_t shard_count ) noexcept;
+    void destroy_shards( uint32_t count ) noexcept;
+    };
+
+  template<typename T, typename A>
+  uint32_t sharded_fifo_internal_tmpl<T,A>::round_shard_count( uint32_t shard_count ) noexcept
+    {
+    if( shard_count == 0 )
+      shard_count = std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+    uint32_t result{ 1 };
+    while( result < shard_count )
+      result <<= 1;
+    return result;
+    }
+
+  template<typename T, typename A>
+  sharded_fifo_internal_tmpl<T,A>::sharded_fifo_internal_tmpl( uint32_t shard_count, allocator_type const & allocator ) :
+      allocator_{ allocator },
+      mask_{ round_shard_count( shard_count ) - 1 },
+      shards_{}
+    {
+    typename shard_traits::allocator_type shard_allocator{ allocator_ };
+    shards_ = shard_traits::allocate( shard_allocator, std::size_t(mask_) + 1 );
+    uint32_t constructed{};
+    try
+      {
+      for( ; constructed <= mask_; ++constructed )
+        shard_traits::construct( shard_allocator, shards_ + constructed, allocator_ );
+      }
+    catch(...)
+      {
+      destroy_shards( constructed );
+      throw;
+      }
+    }
+
+  template<typename T, typename A>
+  sharded_fifo_internal_tmpl<T,A>::~sharded_fifo_internal_tmpl()
+    {
+    destroy_shards( mask_ + 1 );
+    }
+
+  template<typename T, typename A>
+  void sharded_fifo_internal_tmpl<T,A>::destroy_shards( uint32_t count ) noexcept
+    {
+    typename shard_traits::allocator_type shard_allocator{ allocator_ };
+    for( uint32_t index{}; index != count; ++index )
+      shard_traits::destroy( shard_allocator, shards_ + index );
+    shard_traits::deallocate( shard_allocator, shards_, std::size_t(mask_) + 1 );
+    }
+
+  template<typename T, typename A>
+  bool sharded_fifo_internal_tmpl<T,A>::empty() const noexcept
+    {
+    for( uint32_t index{}; index <= mask_; ++index )
+      if( !shards_[index].queue.empty() )
+        return false;
+    return true;
+    }
+
+  template<typename T, typename A>
+  typename sharded_fifo_internal_tmpl<T,A>::size_type
+  sharded_fifo_internal_tmpl<T,A>::size() const noexcept
+    {
+    size_type result{};
+    for( uint32_t index{}; index <= mask_; ++index )
+      result += shards_[index].queue.size();
+    return result;
+    }
+
+  template<typename T, typename A>
+  void sharded_fifo_internal_tmpl<T,A>::push( user_obj_type * user_data )
+    {
+    shards_[ this_thread_index() & mask_ ].queue.push( user_data );
+    }
+
+  template<typename T, typename A>
+  typename sharded_fifo_internal_tmpl<T,A>::user_obj_type *
+  sharded_fifo_internal_tmpl<T,A>::pull()
+    {
+    uint32_t const random { thread_random() };
+    uint32_t first { random & mask_ };
+    uint32_t second { (random >> 16) & mask_ };
+    if( shards_[second].queue.size() > shards_[first].queue.size() )
+      std::swap( first, second );
+
+    user_obj_type * result { shards_[first].queue.pull() };
+    if( result == nullptr && second != first )
+      result = shards_[second].queue.pull();
+    // both choices were empty, scan all shards before reporting empty queue
+    for( uint32_t step{1}; result == nullptr && step <= mask_; ++step )
+      result = shards_[ (first + step) & mask_ ].queue.pull();
+    return result;
+    }
+}
@@ -0,0 +1,283 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// containers placed in memory shared between processes
+// arena_fifo_internal_tmpl and ring_internal_tmpl hold no pointers, only indexes so they may be mapped at different
+// addresses in each process, waiting consumers are woken with process shared futex
+
+#pragma once
+
+#include "common_utils.h"
+#include "eventcount.h"
+#include "arena_fifo_internal.h"
+#include "ring_internal.h"
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // shm_region_t
+  //
+  // owns shared mapping of posix shared memory object or memfd
+  //----------------------------------------------------------------------------------------------------------------------
+  class shm_region_t
+    {
+    int         fd_;
+    void *      data_;
+    std::size_t size_;
+
+  public:
+    shm_region_t() noexcept : fd_{-1}, data_{}, size_{} {}
+    shm_region_t( shm_region_t && rh ) noexcept : fd_{ rh.fd_ }, data_{ rh.data_ }, size_{ rh.size_ }
+      { rh.fd_ = -1; rh.data_ = nullptr; rh.size_ = 0; }
+    shm_region_t & operator=( shm_region_t && rh ) noexcept { swap( rh ); return *this; }
+    shm_region_t( shm_region_t const & ) = delete;
+    shm_region_t & operator=( shm_region_t const & ) = delete;
+    ~shm_region_t() { close(); }
+
+    void *      data() const noexcept          { return data_; }
+    std::size_t size() const noexcept          { return size_; }
+    int         native_handle() const noexcept { return fd_; }
+    explicit operator bool() const noexcept    { return data_ != nullptr; }
+
+    void swap( shm_region_t & rh ) noexcept
+      {
+      std::swap( fd_, rh.fd_ );
+      std::swap( data_, rh.data_ );
+      std::swap( size_, rh.size_ );
+      }
+
+    ///\brief creates new posix shared memory object, fails when name exists
+    /// name is removed again when sizing or mapping fails so retry is possible
+    static shm_region_t create( char const * name, std::size_t size );
+
+    ///\brief opens existing posix shared memory object
+    static shm_region_t open( char const * name )
+      { return from_fd( ::shm_open( name, O_RDWR, 0 ), 0, false, "shm_open" ); }
+
+    ///\brief creates anonymous memory file, descriptor may be inherited by fork or passed with SCM_RIGHTS
+    static shm_region_t create_anonymous( char const * name, std::size_t size )
+      { return from_fd( ::memfd_create( name, MFD_CLOEXEC ), size, true, "memfd_create" ); }
+
+    ///\brief maps existing descriptor, takes ownership of fd
+    static shm_region_t attach( int fd )
+      { return from_fd( fd, 0, false, "attach" ); }
+
+    static void unlink( char const * name ) noexcept { ::shm_unlink( name ); }
+
+  private:
+    static shm_region_t from_fd( int fd, std::size_t size, bool resize, char const * what );
+    void close() noexcept;
+    };
+
+  inline shm_region_t shm_region_t::from_fd( int fd, std::size_t size, bool resize, char const * what )
+    {
+    if( fd < 0 )
+      throw std::system_error( errno, std::generic_category(), what );
+    shm_region_t region;
+    region.fd_ = fd;
+    if( resize )
+      {
+      if( ::ftruncate( fd, static_cast<off_t>( size ) ) != 0 )
+        throw std::system_error( errno, std::generic_category(), "ftruncate" );
+      }
+    else
+      {
+      struct stat st{};
+      if( ::fstat( fd, &st ) != 0 )
+        throw std::system_error( errno, std::generic_category(), "fstat" );
+      size = static_cast<std::size_t>( st.st_size );
+      }
+    void * data { ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) };
+    if( data == MAP_FAILED )
+      throw std::system_error( errno, std::generic_category(), "mmap" );
+    region.data_ = data;
+    region.size_ = size;
+    return region;
+    }
+
+  inline shm_region_t shm_region_t::create( char const * name, std::size_t size )
+    {
+    int const fd { ::shm_open( name, O_CREAT | O_EXCL | O_RDWR, 0600 ) };
+    try
+      {
+      return from_fd( fd, size, true, "shm_open" );
+      }
+    catch(...)
+      {
+      // name which existed before was not created by us
+      if( fd >= 0 )
+        ::shm_unlink( name );
+      throw;
+      }
+    }
+
+  inline void shm_region_t::close() noexcept
+    {
+    if( data_ != nullptr )
+      ::munmap( data_, size_ );
+    if( fd_ >= 0 )
+      ::close( fd_ );
+    data_ = nullptr;
+    fd_ = -1;
+    size_ = 0;
+    }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // shm_queue_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief places queue QUEUE_TYPE in shared region
+  ///\description @{
+  /// region layout is shm header with process shared eventcount followed by queue header and its nodes,
+  /// creator constructs queue, other processes open or attach to already constructed queue,
+  /// queue is never destroyed explicitly, it holds only trivially copyable values and lives as long as the mapping
+  ///@}
+  template<typename QUEUE_TYPE>
+  class shm_queue_tmpl
+    {
+  public:
+    using queue_type = QUEUE_TYPE;
+    using user_obj_type = typename queue_type::user_obj_type;
+    using size_type = typename queue_type::size_type;
+
+    static_assert( std::is_trivially_copyable<user_obj_type>::value, "only trivially copyable types may be shared between processes" );
+    static constexpr uint64_t magic = 0x616d70692d73686dull; // "ampi-shm"
+
+  private:
+    struct alignas(64) header_t
+      {
+      uint64_t     magic_;
+      uint64_t     capacity_;
+      uint32_t     obj_size_;
+      uint32_t     ready_;
+      eventcount_t not_empty_;
+
+      header_t( uint64_t capacity ) noexcept :
+          magic_{ magic }, capacity_{ capacity }, obj_size_{ sizeof(user_obj_type) }, ready_{}, not_empty_{ true }
+        {}
+      };
+
+    shm_region_t region_;
+    header_t *   header_;
+    queue_type * queue_;
+
+  public:
+    ///\returns number of bytes of region required for queue of capacity
+    static std::size_t storage_size( uint64_t capacity ) noexcept
+      { return sizeof(header_t) + queue_type::storage_size( capacity ); }
+
+    ///\brief creates named posix shared memory object with new queue
+    ///\throws std::system_error invalid_argument when capacity exceeds queue_type::max_capacity
+    static shm_queue_tmpl create( char const * name, uint64_t capacity )
+      { return shm_queue_tmpl( shm_region_t::create( name, storage_size( check_capacity( capacity ) ) ), capacity ); }
+
+    ///\brief creates memfd backed queue, its native_handle may be passed to other process
+    static shm_queue_tmpl create_anonymous( char const * name, uint64_t capacity )
+      { return shm_queue_tmpl( shm_region_t::create_anonymous( name, storage_size( check_capacity( capacity ) ) ), capacity ); }
+
+    ///\brief opens queue created by other process
+    static shm_queue_tmpl open( char const * name )
+      { return shm_queue_tmpl( shm_region_t::open( name ) ); }
+
+    ///\brief attaches to queue in region of descriptor fd, takes ownership of fd
+    static shm_queue_tmpl attach( int fd )
+      { return shm_queue_tmpl( shm_region_t::attach( fd ) ); }
+
+  public:
+    shm_queue_tmpl( shm_queue_tmpl && rh ) noexcept :
+        region_{ std::move(rh.region_) }, header_{ rh.header_ }, queue_{ rh.queue_ }
+      { rh.header_ = nullptr; rh.queue_ = nullptr; }
+    shm_queue_tmpl( shm_queue_tmpl const & ) = delete;
+    shm_queue_tmpl & operator=( shm_queue_tmpl const & ) = delete;
+
+    bool        empty() const noexcept           { return queue_->empty(); }
+    size_type   size() const  noexcept           { return queue_->size(); }
+    int         native_handle() const noexcept   { return region_.native_handle(); }
+
+    ///\returns false when queue is full
+    bool push( user_obj_type const & user_data ) noexcept
+      {
+      if( !queue_->push( user_data ) )
+        return false;
+      header_->not_empty_.notify();
+      return true;
+      }
+
+    std::pair<user_obj_type,bool> pull() noexcept
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = queue_->pull( result.first );
+      return result;
+      }
+
+    ///\brief waits on process shared futex until element is available
+    ///\param timeout_ms relative timeout of whole wait, negative value waits infinitely
+    std::pair<user_obj_type,bool> pull_wait( long timeout_ms = -1 ) noexcept
+      {
+      std::pair<user_obj_type,bool> result{};
+      result.second = wait_for( header_->not_empty_, timeout_ms, [this,&result]{ return queue_->pull( result.first ); } );
+      return result;
+      }
+
+  private:
+    static uint64_t check_capacity( uint64_t capacity )
+      {
+      if( capacity > queue_type::max_capacity )
+        throw std::system_error( std::make_error_code( std::errc::invalid_argument ), "shm queue capacity" );
+      return capacity;
+      }
+    shm_queue_tmpl( shm_region_t && region, uint64_t capacity );
+    explicit shm_queue_tmpl( shm_region_t && region );
+    };
+
+  template<typename Q>
+  shm_queue_tmpl<Q>::shm_queue_tmpl( shm_region_t && region, uint64_t capacity ) :
+      region_{ std::move(region) },
+      header_{ new (region_.data()) header_t( capacity ) },
+      queue_{ new (header_ + 1) queue_type( capacity ) }
+    {
+    atomic_store( &header_->ready_, 1u, memorder::release );
+    }
+
+  template<typename Q>
+  shm_queue_tmpl<Q>::shm_queue_tmpl( shm_region_t && region ) :
+      region_{ std::move(region) },
+      header_{ static_cast<header_t *>( region_.data() ) },
+      queue_{ reinterpret_cast<queue_type *>( header_ + 1 ) }
+    {
+    if( region_.size() < sizeof(header_t)
+        || header_->magic_ != magic
+        || header_->obj_size_ != sizeof(user_obj_type)
+        || atomic_load( &header_->ready_, memorder::acquire ) == 0
+        || region_.size() < storage_size( header_->capacity_ ) )
+      throw std::system_error( std::make_error_code( std::errc::invalid_argument ), "shm queue layout mismatch" );
+    }
+}
@@ -0,0 +1,347 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// lock free skiplist priority queue (Linden, Jonsson "A Skiplist-Based Concurrent Priority Queue with Minimal Memory
+// Contention")
+// deleted nodes always form prefix of the list, delete marks are stored in lowest bit of level 0 link of predecessor so
+// pull_min logically deletes first node with single fetch_or. Physical deletion is batched, only when deleted prefix
+// grows over bound_offset pull_min swings head past it with single cas, restructures upper levels and retires prefix
+// nodes through reclamation_domain_t. Nodes which are still being inserted are not removed physically.
+
+#pragma once
+
+#include "common_utils.h"
+#include "reclaim_internal.h"
+#include <array>
+#include <functional>
+#include <new>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // skiplist_pq_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief priority queue pulling element with lowest priority first, order of equal priorities is unspecified
+  template<typename PRIORITY_TYPE, typename USER_OBJ_TYPE, typename COMPARE = std::less<PRIORITY_TYPE>,
+           typename ALLOCATOR = std::allocator<USER_OBJ_TYPE>>
+  class skiplist_pq_internal_tmpl
+    {
+  public:
+    using priority_type = PRIORITY_TYPE;
+    using user_obj_type = USER_OBJ_TYPE;
+    using compare_type = COMPARE;
+    using allocator_type = ALLOCATOR;
+    using size_type = long;
+    static constexpr uint32_t max_level = 32;
+    static constexpr uint32_t default_bound_offset = 32;
+
+  private:
+    // pointer to next node with delete mark of next node in lowest bit
+    using link_type = uintptr_t;
+
+    struct alignas(alignof(std::atomic<link_type>)) node_t
+      {
+      priority_type     priority;
+      user_obj_type     value;
+      uint32_t          level;
+      std::atomic<bool> inserting;
+      // embedded retire record, retiring prefix after element was moved out must not allocate
+      reclamation_domain_t::retired_node_type retired;
+      // retired node may be freed by domain after queue is gone
+      allocator_type    allocator;
+
+      node_t( uint32_t lvl, priority_type const & prio, user_obj_type && user_data, allocator_type const & alloc ) :
+          priority{ prio }, value{ std::move(user_data) }, level{ lvl }, inserting{}, retired{}, allocator{ alloc }
+        {}
+      };
+    ///\brief allocation unit of node with its trailing link array
+    struct alignas(node_t) node_block_t
+      {
+      unsigned char bytes[ alignof(node_t) ];
+      };
+    using block_traits = node_allocator_traits<node_block_t,allocator_type>;
+    using node_array_type = std::array<node_t *,max_level>;
+
+    node_t *                 head_;
+    node_t *                 tail_;
+    alignas(64) std::atomic<size_type> size_;
+    uint32_t                 bound_offset_;
+    compare_type             compare_;
+    reclamation_domain_t &   domain_;
+    allocator_type           allocator_;
+
+  public:
+    bool        empty() const noexcept           { return size_.load(std::memory_order_acquire) <= 0; }
+    size_type   size() const  noexcept           { return size_.load(std::memory_order_acquire); }
+    allocator_type get_allocator() const noexcept { return allocator_; }
+
+  public:
+    ///\param bound_offset length of deleted prefix which triggers physical deletion
+    ///\param allocator nodes retired to domain are freed by it later, so allocator must outlive domain not queue
+    explicit skiplist_pq_internal_tmpl( reclamation_domain_t & domain = default_reclamation_domain(),
+                                        uint32_t bound_offset = default_bound_offset,
+                                        allocator_type const & allocator = allocator_type{} );
+    ~skiplist_pq_internal_tmpl();
+    skiplist_pq_internal_tmpl( skiplist_pq_internal_tmpl const & ) = delete;
+    skiplist_pq_internal_tmpl & operator=( skiplist_pq_internal_tmpl const & ) = delete;
+
+  public:
+    void push( priority_type const & priority, user_obj_type && user_data );
+
+    ///\brief removes element with lowest priority
+    ///\returns false when queue is empty
+    bool pull_min( priority_type & priority, user_obj_type & user_data );
+
+  private:
+    static std::atomic<link_type> * links( node_t * node ) noexcept
+      { return reinterpret_cast<std::atomic<link_type> *>( node + 1 ); }
+    static bool is_marked( link_type link ) noexcept { return (link & 1) != 0; }
+    static node_t * unmarked( link_type link ) noexcept { return reinterpret_cast<node_t *>( link & ~link_type{1} ); }
+    static link_type to_link( node_t * node ) noexcept { return reinterpret_cast<link_type>( node ); }
+
+    static std::size_t block_count( uint32_t level ) noexcept
+      { return ( sizeof(node_t) + level * sizeof(std::atomic<link_type>) + sizeof(node_block_t) - 1 ) / sizeof(node_block_t); }
+    node_t * create_node( uint32_t level, priority_type const & priority, user_obj_type && user_data );
+    static void destroy_node( void * node ) noexcept;
+    static uint32_t random_level() noexcept;
+
+    bool less( node_t * node, priority_type const & priority ) const
+      { return node != tail_ && compare_( node->priority, priority ); }
+    node_t * locate_preds( priority_type const & priority, node_array_type & preds, node_array_type & succs );
+    void restructure() noexcept;
+    };
+
+  template<typename P, typename T, typename C, typename A>
+  skiplist_pq_internal_tmpl<P,T,C,A>::skiplist_pq_internal_tmpl( reclamation_domain_t & domain, uint32_t bound_offset,
+                                                                 allocator_type const & allocator ) :
+      head_{}, tail_{}, size_{}, bound_offset_{ bound_offset }, compare_{}, domain_{ domain }, allocator_{ allocator }
+    {
+    std::unique_ptr<node_t,void(*)(void*)> tail { create_node( max_level, priority_type{}, user_obj_type{} ), &destroy_node };
+    head_ = create_node( max_level, priority_type{}, user_obj_type{} );
+    tail_ = tail.release();
+    for( uint32_t i{}; i != max_level; ++i )
+      links(head_)[i].store( to_link( tail_ ), std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  skiplist_pq_internal_tmpl<P,T,C,A>::~skiplist_pq_internal_tmpl()
+    {
+    // nodes before head level 0 successor are already retired to domain
+    node_t * node { unmarked( links(head_)[0].load( std::memory_order_acquire ) ) };
+    while( node != tail_ )
+      {
+      node_t * next { unmarked( links(node)[0].load( std::memory_order_relaxed ) ) };
+      destroy_node( node );
+      node = next;
+      }
+    destroy_node( head_ );
+    destroy_node( tail_ );
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  typename skiplist_pq_internal_tmpl<P,T,C,A>::node_t *
+  skiplist_pq_internal_tmpl<P,T,C,A>::create_node( uint32_t level, priority_type const & priority, user_obj_type && user_data )
+    {
+    typename block_traits::allocator_type block_allocator{ allocator_ };
+    node_block_t * storage { block_traits::allocate( block_allocator, block_count( level ) ) };
+    node_t * node;
+    try
+      {
+      node = new (storage) node_t( level, priority, std::move(user_data), allocator_ );
+      }
+    catch(...)
+      {
+      block_traits::deallocate( block_allocator, storage, block_count( level ) );
+      throw;
+      }
+    for( uint32_t i{}; i != level; ++i )
+      new (&links(node)[i]) std::atomic<link_type>{};
+    return node;
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  void skiplist_pq_internal_tmpl<P,T,C,A>::destroy_node( void * pointer ) noexcept
+    {
+    node_t * node { static_cast<node_t *>( pointer ) };
+    typename block_traits::allocator_type block_allocator{ node->allocator };
+    std::size_t const count { block_count( node->level ) };
+    node->~node_t();
+    block_traits::deallocate( block_allocator, static_cast<node_block_t *>( pointer ), count );
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  uint32_t skiplist_pq_internal_tmpl<P,T,C,A>::random_level() noexcept
+    {
+    // geometric distribution with p = 1/2
+    return 1 + static_cast<uint32_t>( __builtin_ctz( thread_random() | (1u << (max_level - 1)) ) );
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  typename skiplist_pq_internal_tmpl<P,T,C,A>::node_t *
+  skiplist_pq_internal_tmpl<P,T,C,A>::locate_preds( priority_type const & priority, node_array_type & preds, node_array_type & succs )
+    {
+    node_t * pred { head_ };
+    node_t * del {};
+    for( uint32_t i{ max_level }; i-- != 0; )
+      {
+      link_type cur_link { links(pred)[i].load( std::memory_order_acquire ) };
+      bool deleted { is_marked( cur_link ) };
+      node_t * cur { unmarked( cur_link ) };
+      // skip lower priorities and deleted prefix
+      while( cur != tail_
+             && ( less( cur, priority ) || is_marked( links(cur)[0].load( std::memory_order_acquire ) ) || (i == 0 && deleted) ) )
+        {
+        if( deleted && i == 0 )
+          del = cur;
+        pred = cur;
+        cur_link = links(pred)[i].load( std::memory_order_acquire );
+        deleted = is_marked( cur_link );
+        cur = unmarked( cur_link );
+        }
+      preds[i] = pred;
+      succs[i] = cur;
+      }
+    return del;
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  void skiplist_pq_internal_tmpl<P,T,C,A>::push( priority_type const & priority, user_obj_type && user_data )
+    {
+    uint32_t const level { random_level() };
+    node_t * node { create_node( level, priority, std::move(user_data) ) };
+    node->inserting.store( true, std::memory_order_relaxed );
+
+    reclamation_domain_t::guard_t guard{ domain_ };
+    node_array_type preds;
+    node_array_type succs;
+    node_t * del;
+    for(;;)
+      {
+      del = locate_preds( priority, preds, succs );
+      links(node)[0].store( to_link( succs[0] ), std::memory_order_relaxed );
+      // fails when successor was deleted meanwhile
+      link_type expected { to_link( succs[0] ) };
+      if( links(preds[0])[0].compare_exchange_strong( expected, to_link( node ), std::memory_order_seq_cst ) )
+        break;
+      }
+    size_.fetch_add( size_type{1}, std::memory_order_release );
+
+    // upper levels are only hints, give up when node or its successor gets deleted
+    for( uint32_t i{1}; i < level; )
+      {
+      links(node)[i].store( to_link( succs[i] ), std::memory_order_release );
+      if( is_marked( links(node)[0].load( std::memory_order_acquire ) )
+          || is_marked( links(succs[i])[0].load( std::memory_order_acquire ) )
+          || del == succs[i] )
+        break;
+      link_type expected { to_link( succs[i] ) };
+      if( links(preds[i])[i].compare_exchange_strong( expected, to_link( node ), std::memory_order_seq_cst ) )
+        ++i;
+      else
+        {
+        del = locate_preds( priority, preds, succs );
+        if( succs[0] != node )
+          break;
+        }
+      }
+    node->inserting.store( false, std::memory_order_release );
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  bool skiplist_pq_internal_tmpl<P,T,C,A>::pull_min( priority_type & priority, user_obj_type & user_data )
+    {
+    reclamation_domain_t::guard_t guard{ domain_ };
+    link_type const observed_head { links(head_)[0].load( std::memory_order_acquire ) };
+    node_t * node { head_ };
+    node_t * new_head {};
+    uint32_t offset {};
+    link_type next;
+    do
+      {
+      ++offset;
+      next = links(node)[0].load( std::memory_order_acquire );
+      if( unmarked( next ) == tail_ )
+        return false;
+      // physical deletion must not pass node which is still being inserted
+      if( new_head == nullptr && node->inserting.load( std::memory_order_acquire ) )
+        new_head = node;
+      if( !is_marked( next ) )
+        next = links(node)[0].fetch_or( 1, std::memory_order_seq_cst );
+      node = unmarked( next );
+      }
+    while( is_marked( next ) );
+
+    // successor of node marked by this thread is ours
+    priority = node->priority;
+    user_data = std::move( node->value );
+    size_.fetch_sub( size_type{1}, std::memory_order_release );
+
+    if( new_head == nullptr )
+      new_head = node;
+    if( offset > bound_offset_ && links(head_)[0].load( std::memory_order_acquire ) == observed_head )
+      {
+      link_type expected { observed_head };
+      if( links(head_)[0].compare_exchange_strong( expected, to_link( new_head ) | 1, std::memory_order_seq_cst ) )
+        {
+        restructure();
+        node_t * cur { unmarked( observed_head ) };
+        while( cur != new_head )
+          {
+          node_t * cur_next { unmarked( links(cur)[0].load( std::memory_order_acquire ) ) };
+          domain_.retire( &cur->retired, cur, &destroy_node );
+          cur = cur_next;
+          }
+        }
+      }
+    return true;
+    }
+
+  template<typename P, typename T, typename C, typename A>
+  void skiplist_pq_internal_tmpl<P,T,C,A>::restructure() noexcept
+    {
+    // swing upper level links of head past deleted prefix
+    node_t * pred { head_ };
+    for( uint32_t i{ max_level - 1 }; i > 0; )
+      {
+      link_type head_link { links(head_)[i].load( std::memory_order_acquire ) };
+      node_t * h { unmarked( head_link ) };
+      if( h == tail_ || !is_marked( links(h)[0].load( std::memory_order_acquire ) ) )
+        {
+        --i;
+        continue;
+        }
+      node_t * cur { unmarked( links(pred)[i].load( std::memory_order_acquire ) ) };
+      while( cur != tail_ && is_marked( links(cur)[0].load( std::memory_order_acquire ) ) )
+        {
+        pred = cur;
+        cur = unmarked( links(pred)[i].load( std::memory_order_acquire ) );
+        }
+      if( links(head_)[i].compare_exchange_strong( head_link, links(pred)[i].load( std::memory_order_acquire ), std::memory_order_seq_cst ) )
+        --i;
+      }
+    }
+}
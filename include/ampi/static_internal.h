@@ -0,0 +1,278 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// fixed capacity containers with storage in std::array sized by template parameter, no allocation at all
+// all state is zero at start so objects are constant initialized in static storage and usable before main.
+// static_ring_internal_tmpl is bounded ring (Dmitry Vyukov) with cell sequence stored relative to cell index, which
+// makes initial sequence of every cell zero. static_stack_internal_tmpl is lifo over node array with 32bit index links
+// and 32bit aba tags, unused nodes are taken by bump counter before free list so no initial linking is needed.
+
+#pragma once
+
+#include "common_utils.h"
+#include <array>
+#include <utility>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // static_ring_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief bounded fifo of CAPACITY cells, SINGLE_CONSUMER drops consumer side cas
+  template<typename USER_OBJ_TYPE, uint32_t CAPACITY, bool SINGLE_CONSUMER>
+  class static_ring_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using size_type = long;
+    static constexpr std::size_t cache_line_size = 64;
+    static constexpr uint64_t capacity_value = CAPACITY;
+    static constexpr uint64_t mask = capacity_value - 1;
+    static_assert( CAPACITY >= 2 && ( CAPACITY & ( CAPACITY - 1 ) ) == 0, "capacity must be power of 2" );
+
+  private:
+    struct cell_t
+      {
+      uint64_t      sequence;   ///< sequence minus cell index
+      user_obj_type value;
+      };
+
+    alignas(cache_line_size) uint64_t enqueue_pos_{};
+    alignas(cache_line_size) uint64_t dequeue_pos_{};
+    alignas(cache_line_size) std::array<cell_t,CAPACITY> cells_{};
+
+  public:
+    static constexpr uint64_t capacity() noexcept   { return capacity_value; }
+    size_type size() const noexcept;
+    bool      empty() const noexcept                { return size() == 0; }
+
+  public:
+    constexpr static_ring_internal_tmpl() noexcept = default;
+    static_ring_internal_tmpl( static_ring_internal_tmpl const & ) = delete;
+    static_ring_internal_tmpl & operator=( static_ring_internal_tmpl const & ) = delete;
+
+  public:
+    ///\returns false when ring is full
+    template<typename value_type>
+    bool push( value_type && user_data );
+
+    ///\returns false when ring is empty, with SINGLE_CONSUMER only one thread may pull at a time
+    bool pull( user_obj_type & user_data );
+
+  private:
+    uint64_t sequence( uint64_t pos ) const noexcept
+      { return __atomic_load_n( &cells_[ pos & mask ].sequence, __ATOMIC_ACQUIRE ) + ( pos & mask ); }
+    void publish( uint64_t pos, uint64_t seq ) noexcept
+      { __atomic_store_n( &cells_[ pos & mask ].sequence, seq - ( pos & mask ), __ATOMIC_RELEASE ); }
+    };
+
+  template<typename T, uint32_t C, bool S>
+  typename static_ring_internal_tmpl<T,C,S>::size_type
+  static_ring_internal_tmpl<T,C,S>::size() const noexcept
+    {
+    uint64_t const deq { __atomic_load_n( &dequeue_pos_, __ATOMIC_ACQUIRE ) };
+    uint64_t const enq { __atomic_load_n( &enqueue_pos_, __ATOMIC_ACQUIRE ) };
+    return enq > deq ? static_cast<size_type>( enq - deq ) : 0;
+    }
+
+  template<typename T, uint32_t C, bool S>
+  template<typename value_type>
+  bool static_ring_internal_tmpl<T,C,S>::push( value_type && user_data )
+    {
+    uint64_t pos { __atomic_load_n( &enqueue_pos_, __ATOMIC_RELAXED ) };
+    for(;;)
+      {
+      int64_t const diff { static_cast<int64_t>( sequence( pos ) - pos ) };
+      // cell is free for this position, try to claim it
+      if( diff == 0 )
+        {
+        if( __atomic_compare_exchange_n( &enqueue_pos_, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+          break;
+        }
+      // cell is still occupied by value from previous lap, ring is full
+      else if( diff < 0 )
+        return false;
+      else
+        pos = __atomic_load_n( &enqueue_pos_, __ATOMIC_RELAXED );
+      }
+    cells_[ pos & mask ].value = std::forward<value_type>( user_data );
+    publish( pos, pos + 1 );
+    return true;
+    }
+
+  template<typename T, uint32_t C, bool S>
+  bool static_ring_internal_tmpl<T,C,S>::pull( user_obj_type & user_data )
+    {
+    uint64_t pos { __atomic_load_n( &dequeue_pos_, __ATOMIC_RELAXED ) };
+    if constexpr( S )
+      {
+      // single consumer owns dequeue position
+      if( sequence( pos ) != pos + 1 )
+        return false;
+      __atomic_store_n( &dequeue_pos_, pos + 1, __ATOMIC_RELAXED );
+      }
+    else
+      for(;;)
+        {
+        int64_t const diff { static_cast<int64_t>( sequence( pos ) - ( pos + 1 ) ) };
+        // cell is published for this position, try to claim it
+        if( diff == 0 )
+          {
+          if( __atomic_compare_exchange_n( &dequeue_pos_, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+            break;
+          }
+        // cell was not yet written, ring is empty
+        else if( diff < 0 )
+          return false;
+        else
+          pos = __atomic_load_n( &dequeue_pos_, __ATOMIC_RELAXED );
+        }
+    user_data = std::move( cells_[ pos & mask ].value );
+    // release cell for next lap
+    publish( pos, pos + capacity_value );
+    return true;
+    }
+
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // static_stack_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief bounded lifo of CAPACITY nodes
+  template<typename USER_OBJ_TYPE, uint32_t CAPACITY>
+  class static_stack_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using pointer_type = index_pointer_t;
+    using index_type = pointer_type::index_type;
+    using size_type = long;
+    static constexpr std::size_t cache_line_size = 64;
+    static_assert( CAPACITY != 0 && CAPACITY < ~index_type{}, "capacity must fit in index" );
+
+  private:
+    struct node_t
+      {
+      index_type    next;
+      user_obj_type value;
+      };
+
+    alignas(cache_line_size) int64_t head_{};
+    alignas(cache_line_size) int64_t free_{};
+    index_type                       unused_{};
+    alignas(cache_line_size) size_type size_{};
+    std::array<node_t,CAPACITY>      nodes_{};
+
+  public:
+    static constexpr index_type capacity() noexcept { return CAPACITY; }
+    size_type size() const noexcept                 { return __atomic_load_n( &size_, __ATOMIC_ACQUIRE ); }
+    bool      empty() const noexcept                { return pointer_type{ __atomic_load_n( &head_, __ATOMIC_ACQUIRE ) }.index() == pointer_type::null_index; }
+
+  public:
+    constexpr static_stack_internal_tmpl() noexcept = default;
+    static_stack_internal_tmpl( static_stack_internal_tmpl const & ) = delete;
+    static_stack_internal_tmpl & operator=( static_stack_internal_tmpl const & ) = delete;
+
+  public:
+    ///\returns false when all nodes are in use
+    template<typename value_type>
+    bool push( value_type && user_data );
+
+    ///\returns false when stack is empty
+    bool pull( user_obj_type & user_data );
+
+  private:
+    node_t & node_at( index_type index ) noexcept { return nodes_[ index - 1 ]; }
+    index_type pop_list( int64_t & list ) noexcept;
+    void push_list( int64_t & list, index_type index ) noexcept;
+    index_type alloc() noexcept;
+    };
+
+  template<typename T, uint32_t C>
+  typename static_stack_internal_tmpl<T,C>::index_type
+  static_stack_internal_tmpl<T,C>::pop_list( int64_t & list ) noexcept
+    {
+    pointer_type head { __atomic_load_n( &list, __ATOMIC_ACQUIRE ) };
+    while( head )
+      {
+      // node may be already reused by other thread, tag of list invalidates cas then
+      index_type const next { __atomic_load_n( &node_at( head.index() ).next, __ATOMIC_RELAXED ) };
+      if( __atomic_compare_exchange_n( &list, &head.cas_value, pointer_type{ next, head.tag() + 1 }.cas_value, true,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) )
+        return head.index();
+      }
+    return pointer_type::null_index;
+    }
+
+  template<typename T, uint32_t C>
+  void static_stack_internal_tmpl<T,C>::push_list( int64_t & list, index_type index ) noexcept
+    {
+    pointer_type head { __atomic_load_n( &list, __ATOMIC_RELAXED ) };
+    do
+      __atomic_store_n( &node_at( index ).next, head.index(), __ATOMIC_RELAXED );
+    while( !__atomic_compare_exchange_n( &list, &head.cas_value, pointer_type{ index, head.tag() + 1 }.cas_value, true,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED ) );
+    }
+
+  template<typename T, uint32_t C>
+  typename static_stack_internal_tmpl<T,C>::index_type
+  static_stack_internal_tmpl<T,C>::alloc() noexcept
+    {
+    if( index_type index = pop_list( free_ ) )
+      return index;
+    // nodes never used yet are taken in order
+    index_type unused { __atomic_load_n( &unused_, __ATOMIC_RELAXED ) };
+    while( unused < C )
+      if( __atomic_compare_exchange_n( &unused_, &unused, unused + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+        return unused + 1;
+    return pointer_type::null_index;
+    }
+
+  template<typename T, uint32_t C>
+  template<typename value_type>
+  bool static_stack_internal_tmpl<T,C>::push( value_type && user_data )
+    {
+    index_type const index { alloc() };
+    if( index == pointer_type::null_index )
+      return false;
+    node_at( index ).value = std::forward<value_type>( user_data );
+    push_list( head_, index );
+    __atomic_add_fetch( &size_, size_type{1}, __ATOMIC_RELEASE );
+    return true;
+    }
+
+  template<typename T, uint32_t C>
+  bool static_stack_internal_tmpl<T,C>::pull( user_obj_type & user_data )
+    {
+    index_type const index { pop_list( head_ ) };
+    if( index == pointer_type::null_index )
+      return false;
+    user_data = std::move( node_at( index ).value );
+    push_list( free_, index );
+    __atomic_sub_fetch( &size_, size_type{1}, __ATOMIC_RELEASE );
+    return true;
+    }
+}
@@ -0,0 +1,399 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// wait-free fifo (Kogan, Petrank "Wait-free queues with multiple enqueuers and dequeuers")
+// every operation gets phase number and publishes its descriptor in state array, before own operation thread helps all
+// pending operations with lower or equal phase so each operation completes in number of steps bounded by number of
+// thread slots. Original algorithm relies on garbage collector, here nodes live in slab and links are 32bit indexes with
+// 32bit tags, node carries generation in its dequeuer word so stale helpers can not mark reused node. Node is reused when
+// both its value was taken by dequeuer and it was removed as dummy head.
+// Operations are wait-free as long as there are no more concurrent operations than thread slots, node allocation uses
+// lock free free list.
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <thread>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // wf_fifo_internal_tmpl
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  template<typename USER_OBJ_TYPE>
+  class wf_fifo_internal_tmpl
+    {
+  public:
+    using user_obj_type = USER_OBJ_TYPE;
+    using pointer_type = index_pointer_t;
+    using index_type = index_pointer_t::index_type;
+    using size_type = long;
+    static constexpr uint32_t no_thread = 0xFFFFFFFFu;
+    static constexpr index_type max_nodes = (1u << 30) - 1;
+
+  private:
+    struct node_t
+      {
+      std::atomic<pointer_type> next;
+      // generation << 32 | slot of dequeuing thread
+      std::atomic<uint64_t>     deq;
+      std::atomic<uint32_t>     refs;
+      // read by helpers of recycled node while it is rewritten
+      std::atomic<uint32_t>     enq_tid;
+      user_obj_type             value;
+
+      node_t() : next{}, deq{ no_thread }, refs{}, enq_tid{ no_thread }, value{} {}
+      };
+
+    // operation descriptor packed in single cas word, phase << 32 | pending << 31 | enqueue << 30 | node index
+    struct desc_t
+      {
+      uint64_t value;
+
+      desc_t( uint64_t v ) noexcept : value{ v } {}
+      desc_t( uint32_t phase, bool pending, bool enqueue, index_type node ) noexcept :
+          value{ (uint64_t(phase) << 32) | (uint64_t(pending) << 31) | (uint64_t(enqueue) << 30) | node }
+        {}
+      uint32_t   phase() const noexcept   { return static_cast<uint32_t>( value >> 32 ); }
+      bool       pending() const noexcept { return ((value >> 31) & 1) != 0; }
+      bool       enqueue() const noexcept { return ((value >> 30) & 1) != 0; }
+      index_type node() const noexcept    { return static_cast<index_type>( value & max_nodes ); }
+      };
+
+    struct alignas(64) thread_slot_t
+      {
+      std::atomic<uint64_t> state;
+      std::atomic<uint32_t> owner;
+      };
+
+    alignas(64) std::atomic<pointer_type> head_;
+    alignas(64) std::atomic<pointer_type> tail_;
+    alignas(64) std::atomic<pointer_type> free_;
+    alignas(64) std::atomic<uint32_t>     phase_;
+    alignas(64) std::atomic<size_type>    size_;
+    std::unique_ptr<node_t[]>             nodes_;
+    std::unique_ptr<thread_slot_t[]>      slots_;
+    uint32_t                              thread_count_;
+    index_type                            node_count_;
+
+  public:
+    bool        empty() const noexcept           { return size_.load(std::memory_order_acquire) <= 0; }
+    size_type   size() const  noexcept           { return size_.load(std::memory_order_acquire); }
+    uint32_t    thread_count() const noexcept    { return thread_count_; }
+
+  public:
+    ///\param capacity number of elements queue can hold
+    ///\param thread_count number of thread slots, 0 selects twice the hardware concurrency
+    explicit wf_fifo_internal_tmpl( index_type capacity, uint32_t thread_count = 0 );
+    wf_fifo_internal_tmpl( wf_fifo_internal_tmpl const & ) = delete;
+    wf_fifo_internal_tmpl & operator=( wf_fifo_internal_tmpl const & ) = delete;
+
+  public:
+    ///\returns false when there is no free node
+    bool push( user_obj_type && user_data );
+
+    ///\returns false when queue is empty
+    bool pull( user_obj_type & user_data );
+
+  private:
+    node_t & node_at( index_type index ) noexcept { return nodes_[index - 1]; }
+    static bool phase_le( uint32_t l, uint32_t r ) noexcept { return static_cast<int32_t>( l - r ) <= 0; }
+    bool is_still_pending( uint32_t tid, uint32_t phase ) const noexcept;
+
+    uint32_t claim_slot() noexcept;
+    index_type alloc() noexcept;
+    void release( index_type index ) noexcept;
+
+    void help( uint32_t phase );
+    void help_enq( uint32_t tid, uint32_t phase );
+    void help_finish_enq();
+    void help_deq( uint32_t tid, uint32_t phase );
+    void help_finish_deq();
+    };
+
+  template<typename T>
+  wf_fifo_internal_tmpl<T>::wf_fifo_internal_tmpl( index_type capacity, uint32_t thread_count ) :
+      head_{}, tail_{}, free_{}, phase_{}, size_{}
+    {
+    thread_count_ = thread_count != 0 ? thread_count : std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+    // dummy and nodes which wait for release by dequeuing threads
+    node_count_ = static_cast<index_type>( std::min<uint64_t>( uint64_t( capacity ) + 1 + thread_count_, max_nodes ) );
+    nodes_ = std::make_unique<node_t[]>( node_count_ );
+    slots_ = std::make_unique<thread_slot_t[]>( thread_count_ );
+    for( uint32_t tid{}; tid != thread_count_; ++tid )
+      {
+      slots_[tid].state.store( desc_t{ 0, false, false, pointer_type::null_index }.value, std::memory_order_relaxed );
+      slots_[tid].owner.store( 0, std::memory_order_relaxed );
+      }
+    // first node is dummy without value
+    node_at(1).refs.store( 1, std::memory_order_relaxed );
+    head_.store( pointer_type{ 1, 0 }, std::memory_order_relaxed );
+    tail_.store( pointer_type{ 1, 0 }, std::memory_order_relaxed );
+    for( index_type index{2}; index <= node_count_; ++index )
+      node_at(index).next.store( pointer_type{ index != node_count_ ? index + 1 : pointer_type::null_index, 0 }, std::memory_order_relaxed );
+    free_.store( pointer_type{ node_count_ > 1 ? 2u : pointer_type::null_index, 0 }, std::memory_order_release );
+    }
+
+  template<typename T>
+  uint32_t wf_fifo_internal_tmpl<T>::claim_slot() noexcept
+    {
+    uint32_t const start { this_thread_index() };
+    for(;;)
+      {
+      for( uint32_t step{}; step != thread_count_; ++step )
+        {
+        uint32_t const tid { (start + step) % thread_count_ };
+        uint32_t free_slot{};
+        if( slots_[tid].owner.load( std::memory_order_relaxed ) == 0
+            && slots_[tid].owner.compare_exchange_strong( free_slot, 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+          return tid;
+        }
+      // more concurrent operations than slots
+      std::this_thread::yield();
+      }
+    }
+
+  template<typename T>
+  typename wf_fifo_internal_tmpl<T>::index_type
+  wf_fifo_internal_tmpl<T>::alloc() noexcept
+    {
+    pointer_type head { free_.load( std::memory_order_acquire ) };
+    while( head )
+      {
+      pointer_type next { node_at( head.index() ).next.load( std::memory_order_relaxed ) };
+      if( free_.compare_exchange_weak( head, pointer_type{ next.index(), head.tag() + 1 }, std::memory_order_acquire, std::memory_order_acquire ) )
+        {
+        node_t & node { node_at( head.index() ) };
+        node.next.store( pointer_type{ pointer_type::null_index, next.tag() + 1 }, std::memory_order_relaxed );
+        return head.index();
+        }
+      }
+    return pointer_type::null_index;
+    }
+
+  template<typename T>
+  void wf_fifo_internal_tmpl<T>::release( index_type index ) noexcept
+    {
+    node_t & node { node_at( index ) };
+    if( node.refs.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+      return;
+    // new generation invalidates cas of stale helpers on dequeuer word
+    uint64_t const generation { (node.deq.load( std::memory_order_relaxed ) >> 32) + 1 };
+    node.deq.store( (generation << 32) | no_thread, std::memory_order_relaxed );
+    pointer_type head { free_.load( std::memory_order_relaxed ) };
+    pointer_type const next { node.next.load( std::memory_order_relaxed ) };
+    do
+      node.next.store( pointer_type{ head.index(), next.tag() + 1 }, std::memory_order_relaxed );
+    while( !free_.compare_exchange_weak( head, pointer_type{ index, head.tag() + 1 }, std::memory_order_release, std::memory_order_relaxed ) );
+    }
+
+  template<typename T>
+  bool wf_fifo_internal_tmpl<T>::is_still_pending( uint32_t tid, uint32_t phase ) const noexcept
+    {
+    desc_t const desc { slots_[tid].state.load( std::memory_order_acquire ) };
+    return desc.pending() && phase_le( desc.phase(), phase );
+    }
+
+  template<typename T>
+  void wf_fifo_internal_tmpl<T>::help( uint32_t phase )
+    {
+    for( uint32_t tid{}; tid != thread_count_; ++tid )
+      {
+      desc_t const desc { slots_[tid].state.load( std::memory_order_acquire ) };
+      if( desc.pending() && phase_le( desc.phase(), phase ) )
+        {
+        if( desc.enqueue() )
+          help_enq( tid, phase );
+        else
+          help_deq( tid, phase );
+        }
+      }
+    }
+
+  template<typename T>
+  void wf_fifo_internal_tmpl<T>::help_enq( uint32_t tid, uint32_t phase )
+    {
+    while( is_still_pending( tid, phase ) )
+      {
+      pointer_type last { tail_.load( std::memory_order_acquire ) };
+      pointer_type next { node_at( last.index() ).next.load( std::memory_order_acquire ) };
+      if( last == tail_.load( std::memory_order_acquire ) )
+        {
+        if( !next )
+          {
+          desc_t const desc { slots_[tid].state.load( std::memory_order_acquire ) };
+          if( desc.pending() && phase_le( desc.phase(), phase ) )
+            {
+            if( node_at( last.index() ).next.compare_exchange_strong( next, pointer_type{ desc.node(), next.tag() + 1 }, std::memory_order_seq_cst ) )
+              {
+              help_finish_enq();
+              return;
+              }
+            }
+          }
+        else
+          // some enqueue is in progress, finish it first
+          help_finish_enq();
+        }
+      }
+    }
+
+  template<typename T>
+  void wf_fifo_internal_tmpl<T>::help_finish_enq()
+    {
+    pointer_type last { tail_.load( std::memory_order_acquire ) };
+    pointer_type const next { node_at( last.index() ).next.load( std::memory_order_acquire ) };
+    if( next )
+      {
+      uint32_t const tid { node_at( next.index() ).enq_tid.load( std::memory_order_acquire ) };
+      if( tid >= thread_count_ )
+        return;
+      desc_t const cur_desc { slots_[tid].state.load( std::memory_order_acquire ) };
+      if( last == tail_.load( std::memory_order_acquire ) && cur_desc.node() == next.index() )
+        {
+        uint64_t expected { cur_desc.value };
+        slots_[tid].state.compare_exchange_strong( expected, desc_t{ cur_desc.phase(), false, true, next.index() }.value, std::memory_order_seq_cst );
+        tail_.compare_exchange_strong( last, pointer_type{ next.index(), last.tag() + 1 }, std::memory_order_seq_cst );
+        }
+      }
+    }
+
+  template<typename T>
+  void wf_fifo_internal_tmpl<T>::help_deq( uint32_t tid, uint32_t phase )
+    {
+    while( is_still_pending( tid, phase ) )
+      {
+      pointer_type first { head_.load( std::memory_order_acquire ) };
+      pointer_type last { tail_.load( std::memory_order_acquire ) };
+      node_t & first_node { node_at( first.index() ) };
+      pointer_type next { first_node.next.load( std::memory_order_acquire ) };
+      // generation read before validation of head belongs to current incarnation of first
+      uint64_t const deq_word { first_node.deq.load( std::memory_order_acquire ) };
+      if( first != head_.load( std::memory_order_acquire ) )
+        continue;
+      if( first.index() == last.index() )
+        {
+        if( !next )
+          {
+          // queue is empty, finish operation with no node
+          desc_t const cur_desc { slots_[tid].state.load( std::memory_order_acquire ) };
+          if( last == tail_.load( std::memory_order_acquire ) && cur_desc.pending() && phase_le( cur_desc.phase(), phase ) )
+            {
+            uint64_t expected { cur_desc.value };
+            slots_[tid].state.compare_exchange_strong( expected, desc_t{ cur_desc.phase(), false, false, pointer_type::null_index }.value, std::memory_order_seq_cst );
+            }
+          }
+        else
+          // tail is lagging, finish enqueue in progress
+          help_finish_enq();
+        }
+      else
+        {
+        desc_t const cur_desc { slots_[tid].state.load( std::memory_order_acquire ) };
+        if( !(cur_desc.pending() && phase_le( cur_desc.phase(), phase )) )
+          break;
+        if( first == head_.load( std::memory_order_acquire ) && cur_desc.node() != first.index() )
+          {
+          uint64_t expected { cur_desc.value };
+          if( !slots_[tid].state.compare_exchange_strong( expected, desc_t{ cur_desc.phase(), true, false, first.index() }.value, std::memory_order_seq_cst ) )
+            continue;
+          }
+        if( (deq_word & 0xFFFFFFFFu) == no_thread )
+          {
+          uint64_t expected { deq_word };
+          first_node.deq.compare_exchange_strong( expected, (deq_word & ~uint64_t{0xFFFFFFFFu}) | tid, std::memory_order_seq_cst );
+          }
+        help_finish_deq();
+        }
+      }
+    }
+
+  template<typename T>
+  void wf_fifo_internal_tmpl<T>::help_finish_deq()
+    {
+    pointer_type first { head_.load( std::memory_order_acquire ) };
+    node_t & first_node { node_at( first.index() ) };
+    pointer_type const next { first_node.next.load( std::memory_order_acquire ) };
+    uint32_t const tid { static_cast<uint32_t>( first_node.deq.load( std::memory_order_acquire ) & 0xFFFFFFFFu ) };
+    if( tid < thread_count_ )
+      {
+      desc_t const cur_desc { slots_[tid].state.load( std::memory_order_acquire ) };
+      if( first == head_.load( std::memory_order_acquire ) && next )
+        {
+        uint64_t expected { cur_desc.value };
+        slots_[tid].state.compare_exchange_strong( expected, desc_t{ cur_desc.phase(), false, false, cur_desc.node() }.value, std::memory_order_seq_cst );
+        head_.compare_exchange_strong( first, pointer_type{ next.index(), first.tag() + 1 }, std::memory_order_seq_cst );
+        }
+      }
+    }
+
+  template<typename T>
+  bool wf_fifo_internal_tmpl<T>::push( user_obj_type && user_data )
+    {
+    index_type const index { alloc() };
+    if( index == pointer_type::null_index )
+      return false;
+    node_t & node { node_at( index ) };
+    node.value = std::move( user_data );
+    // one reference for value taken by dequeuer and one for removal as dummy head
+    node.refs.store( 2, std::memory_order_relaxed );
+
+    uint32_t const tid { claim_slot() };
+    // published before node is linked by release of slot state and cas of next
+    node.enq_tid.store( tid, std::memory_order_release );
+    uint32_t const phase { phase_.fetch_add( 1, std::memory_order_seq_cst ) + 1 };
+    slots_[tid].state.store( desc_t{ phase, true, true, index }.value, std::memory_order_seq_cst );
+    help( phase );
+    help_finish_enq();
+    slots_[tid].owner.store( 0, std::memory_order_release );
+    size_.fetch_add( size_type{1}, std::memory_order_release );
+    return true;
+    }
+
+  template<typename T>
+  bool wf_fifo_internal_tmpl<T>::pull( user_obj_type & user_data )
+    {
+    uint32_t const tid { claim_slot() };
+    uint32_t const phase { phase_.fetch_add( 1, std::memory_order_seq_cst ) + 1 };
+    slots_[tid].state.store( desc_t{ phase, true, false, pointer_type::null_index }.value, std::memory_order_seq_cst );
+    help( phase );
+    help_finish_deq();
+    desc_t const desc { slots_[tid].state.load( std::memory_order_acquire ) };
+    slots_[tid].owner.store( 0, std::memory_order_release );
+
+    index_type const first { desc.node() };
+    if( first == pointer_type::null_index )
+      return false;
+    // removal reference of first is still held so its next link is stable
+    index_type const next { node_at( first ).next.load( std::memory_order_acquire ).index() };
+    user_data = std::move( node_at( next ).value );
+    release( next );
+    release( first );
+    size_.fetch_sub( size_type{1}, std::memory_order_release );
+    return true;
+    }
+}
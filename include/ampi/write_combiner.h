@@ -0,0 +1,144 @@
+// MIT License
+// 
+// Copyright (c) 2019 Artur Bac
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Non-Blocking Concurrent Queue Algorithms, lock free
+
+// producer side write combining
+// producer stages elements in private buffer and publishes them with queue push_range, which links whole batch with
+// single cas. Batch is flushed when it reaches count limit, when oldest staged element exceeds latency budget, on
+// explicit flush and in destructor, so buffer declared thread_local is flushed at thread exit. Flush publishes slices
+// small enough for push_range to link each one at once, so after failed push_range exactly the published prefix leaves
+// the buffer.
+
+#pragma once
+
+#include "common_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <vector>
+
+namespace ampi
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  //
+  // write_combiner_t
+  //
+  //----------------------------------------------------------------------------------------------------------------------
+  ///\brief per producer staging buffer in front of QUEUE with push_range, afifo_t and fifo_queue_t fit
+  ///\description @{
+  /// buffer belongs to single producer thread. Clock is read when first element is staged and latency budget is checked
+  /// on every clock_check_interval staged elements, producer that may go idle with staged elements should call
+  /// flush_if_due() or flush() from its loop.
+  ///@}
+  template<typename QUEUE>
+  class write_combiner_t
+    {
+  public:
+    using queue_type = QUEUE;
+    using user_obj_type = typename queue_type::user_obj_type;
+    using clock_type = std::chrono::steady_clock;
+    using size_type = std::size_t;
+    ///\brief elements published by one push_range call, fifo_queue_t links up to 64 elements with single cas
+    static constexpr size_type flush_slice = 64;
+    ///\brief staged element count between latency budget checks on push
+    static constexpr size_type clock_check_interval = 16;
+
+  private:
+    queue_type &                queue_;
+    std::vector<user_obj_type>  staged_;
+    size_type                   max_batch_;
+    clock_type::duration        max_delay_;
+    clock_type::time_point      oldest_;
+
+  public:
+    ///\param max_batch staged element count which triggers flush
+    ///\param max_delay longest time element may stay staged before push flushes it
+    explicit write_combiner_t( queue_type & queue, size_type max_batch = 64,
+                               clock_type::duration max_delay = std::chrono::microseconds{100} ) :
+        queue_{ queue },
+        staged_{},
+        max_batch_{ max_batch != 0 ? max_batch : 1 },
+        max_delay_{ max_delay },
+        oldest_{}
+      { staged_.reserve( max_batch_ ); }
+    ///\brief flushes staged elements, when queue can not take them they are dropped as destructor may not throw
+    ~write_combiner_t()
+      {
+      try
+        {
+        flush();
+        }
+      catch(...)
+        {
+        }
+      }
+    write_combiner_t( write_combiner_t const & ) = delete;
+    write_combiner_t & operator=( write_combiner_t const & ) = delete;
+
+    size_type   staged() const noexcept       { return staged_.size(); }
+    queue_type & queue() const noexcept       { return queue_; }
+
+    template<typename value_type>
+    void push( value_type && user_data )
+      {
+      bool const first { staged_.empty() };
+      staged_.emplace_back( std::forward<value_type>(user_data) );
+      if( first )
+        oldest_ = clock_type::now();
+      size_type const count { staged_.size() };
+      if( count >= max_batch_ || ( count % clock_check_interval == 0 && clock_type::now() - oldest_ >= max_delay_ ) )
+        flush();
+      }
+
+    ///\brief publishes staged elements when oldest of them exceeded latency budget
+    void flush_if_due()
+      {
+      if( !staged_.empty() && clock_type::now() - oldest_ >= max_delay_ )
+        flush();
+      }
+
+    ///\brief publishes all staged elements
+    ///\description @{
+    /// when push_range throws, already published slices are removed and remaining elements stay staged for next flush
+    ///@}
+    void flush()
+      {
+      auto first { staged_.begin() };
+      try
+        {
+        while( first != staged_.end() )
+          {
+          auto const last { first + std::min<std::ptrdiff_t>( staged_.end() - first, flush_slice ) };
+          queue_.push_range( first, last );
+          first = last;
+          }
+        }
+      catch(...)
+        {
+        staged_.erase( staged_.begin(), first );
+        throw;
+        }
+      staged_.clear();
+      }
+    };
+}
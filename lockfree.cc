@@ -7,6 +7,11 @@
 #include <numeric>
 #include <future>
 #include <queue>
+#include <thread>
+#include <cstring>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <sys/epoll.h>
 
 struct message_t
   { 
@@ -141,6 +146,65 @@ BOOST_AUTO_TEST_CASE( lock_free_afifo_test_single )
 BOOST_TEST( message_t::instance_counter == 0 );
 }
 
+BOOST_AUTO_TEST_CASE( lock_free_afifo_test_drain )
+{
+  message_t::instance_counter  = 0;
+  {
+  afifo_type queue;
+  BOOST_TEST( queue.drain().empty() );
+  for( uint32_t i{}; i != 10; ++i )
+    ampi::push( queue, message_t{i} );
+  BOOST_TEST( queue.size() == 10 );
+  //pull accounts whole detached list
+  auto [it, succeed] { ampi::pull( queue ) };
+  BOOST_TEST( succeed );
+  BOOST_TEST( queue.size() == 0 );
+  while( !it.empty() )
+    ampi::pull( it );
+  
+  for( uint32_t i{}; i != 10; ++i )
+    ampi::push( queue, message_t{i} );
+  auto drained { queue.drain() };
+  //detached list is accounted at once
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( queue.size() == 0 );
+  for( uint32_t i{}; i != 10; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( drained );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{i}) );
+    }
+  BOOST_TEST( drained.empty() );
+  
+  //not taken elements are freed with iterator, which may outlive queue
+  ampi::afifo_t<message_t>::drain_iterator_type dropped;
+    {
+    afifo_type other;
+    ampi::push( other, message_t{1} );
+    ampi::push( other, message_t{2} );
+    dropped = other.drain();
+    BOOST_TEST( other.size() == 0 );
+    }
+  BOOST_TEST( ampi::pull( dropped ).first == (message_t{1}) );
+  
+  //length above 20bit head word field is counted in reversal pass of drain
+  for( uint32_t count : { 100000u, ( 1u << 20 ) + 10 } )
+    {
+    for( uint32_t i{}; i != count; ++i )
+      ampi::push( queue, message_t{i} );
+    BOOST_TEST( queue.size() == count );
+    auto burst { queue.drain() };
+    BOOST_TEST( queue.size() == 0 );
+    bool in_order { true };
+    for( uint32_t i{}; i != count; ++i )
+      in_order = in_order && ampi::pull( burst ).first == (message_t{i});
+    BOOST_TEST( in_order );
+    BOOST_TEST( burst.empty() );
+    }
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
 BOOST_AUTO_TEST_CASE( lock_free_afifo_test_2threads )
 {
 message_t::instance_counter  = 0;
@@ -612,3 +676,1987 @@ message_t::instance_counter  = 0;
 BOOST_TEST( message_t::instance_counter == 0 );
 }
 #endif
+
+//---------------------------------------------------------------------------------------------
+
+using arena_fifo_type = ampi::arena_fifo_t<uint32_t>;
+BOOST_AUTO_TEST_CASE( lock_free_arena_fifo_test_single )
+{
+  arena_fifo_type queue{ 4 };
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( queue.capacity() == 4u );
+
+  for( uint32_t i{}; i != 4; ++i )
+    BOOST_TEST( queue.push( i ) );
+  //arena exhausted
+  BOOST_TEST( !queue.push( 4 ) );
+  BOOST_TEST( queue.size() == 4 );
+
+  for( uint32_t i{}; i != 4; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == i );
+    }
+  BOOST_TEST( !ampi::pull( queue ).second );
+  BOOST_TEST( queue.empty() );
+
+  //nodes are reused
+  for( uint32_t i{}; i != 0xFFFF; ++i )
+    {
+    BOOST_TEST( queue.push( i ) );
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == i );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_arena_fifo_test_relocate )
+{
+  using base_type = arena_fifo_type::base_type;
+  constexpr uint32_t capacity = 16;
+  std::size_t const storage_size{ base_type::storage_size( capacity ) };
+  auto alloc_storage = [storage_size]() { return static_cast<char *>( ::operator new( storage_size, std::align_val_t{ alignof(base_type) } ) ); };
+  char * storage{ alloc_storage() };
+  base_type * queue{ new (storage) base_type( capacity ) };
+  for( uint32_t i{}; i != 10; ++i )
+    queue->push( i );
+  uint32_t result{};
+  queue->pull( result );
+  BOOST_TEST( result == 0u );
+
+  //there are no pointers in arena, queue can be moved as raw memory
+  char * relocated_storage{ alloc_storage() };
+  std::memcpy( relocated_storage, storage, storage_size );
+  ::operator delete( storage, std::align_val_t{ alignof(base_type) } );
+  queue = reinterpret_cast<base_type *>( relocated_storage );
+
+  for( uint32_t i{10}; i != 16; ++i )
+    BOOST_TEST( queue->push( i ) );
+  for( uint32_t i{1}; i != 16; ++i )
+    {
+    BOOST_TEST( queue->pull( result ) );
+    BOOST_TEST( result == i );
+    }
+  BOOST_TEST( queue->empty() );
+  queue->~base_type();
+  ::operator delete( relocated_storage, std::align_val_t{ alignof(base_type) } );
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_arena_fifo_test_3threads_2recv_1send, * boost::unit_test::timeout(60) )
+{
+  arena_fifo_type queue{ 1024 };
+  uint32_t number_of_messages= 0xFFFFF;
+  std::atomic<uint32_t> recived_count{};
+  std::atomic<uint64_t> sum{};
+
+  auto recv = [&queue, &recived_count, &sum, number_of_messages]()
+                {
+                uint32_t last_id{};
+                bool first{ true };
+                while( recived_count.load() != number_of_messages )
+                  {
+                  auto [result, succeed] = ampi::pull( queue );
+                  if( succeed )
+                    {
+                    //each reciver must see increasing order
+                    BOOST_TEST( (first || result > last_id) );
+                    first = false;
+                    last_id = result;
+                    sum.fetch_add( result );
+                    recived_count.fetch_add( 1 );
+                    }
+                  else
+                    std::this_thread::yield();
+                  }
+                };
+  auto reciver = std::async(std::launch::async, recv );
+  auto reciver2 = std::async(std::launch::async, recv );
+  auto sender = std::async(std::launch::async,
+                           [&queue, number_of_messages]()
+                            {
+                            for( uint32_t i{}; i != number_of_messages; )
+                              if( queue.push( i ) )
+                                ++i;
+                              else
+                                std::this_thread::yield();
+                            });
+  sender.get();
+  reciver.get();
+  reciver2.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2};
+  BOOST_TEST( sum.load() == expected_sum );
+  BOOST_TEST( queue.empty() );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using ring_type = ampi::ring_t<message_t>;
+BOOST_AUTO_TEST_CASE( lock_free_ring_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  ring_type queue{ 3 };
+  BOOST_TEST( queue.capacity() == 4u );
+  BOOST_TEST( queue.empty() );
+  for( uint32_t i{}; i != 4; ++i )
+    BOOST_TEST( queue.push( message_t{ i } ) );
+  BOOST_TEST( !queue.push( message_t{ 4 } ) );
+  BOOST_TEST( queue.size() == 4 );
+
+  for( uint32_t i{}; i != 0xFFFF; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{ i }) );
+    BOOST_TEST( queue.push( message_t{ i + 4 } ) );
+    }
+  for( uint32_t i{}; i != 4; ++i )
+    BOOST_TEST( ampi::pull( queue ).second );
+  BOOST_TEST( !ampi::pull( queue ).second );
+  BOOST_TEST( queue.empty() );
+  }
+//cells hold default constructed values
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_ring_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  ampi::ring_t<uint32_t> queue{ 1024 };
+  uint32_t number_of_messages= 0x3FFFF;
+  constexpr size_t number_of_senders = 4;
+  std::atomic<uint64_t> sum{};
+  std::atomic<uint32_t> recived_count{};
+
+  auto fn_dequeue = [&]()
+                    {
+                    while( recived_count.load() != number_of_messages * number_of_senders )
+                      {
+                      auto [ result, succeed ] = ampi::pull( queue );
+                      if( succeed )
+                        {
+                        sum.fetch_add( result );
+                        recived_count.fetch_add( 1 );
+                        }
+                      else
+                        std::this_thread::yield();
+                      }
+                    };
+  auto fn_enqueue = [&]()
+                    {
+                    for( uint32_t i{}; i != number_of_messages; )
+                      if( queue.push( i ) )
+                        ++i;
+                      else
+                        std::this_thread::yield();
+                    };
+  std::vector<std::future<void>> threads;
+  for( size_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  for( auto & thread : threads )
+    thread.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  BOOST_TEST( sum.load() == expected_sum );
+  BOOST_TEST( queue.empty() );
+}
+
+//---------------------------------------------------------------------------------------------
+
+template<typename shm_queue_type>
+static void shm_queue_interprocess_test()
+{
+  std::string const name{ "/ampi_ut_" + std::to_string( getpid() ) };
+  shm_queue_type queue{ shm_queue_type::create( name.c_str(), 64 ) };
+  uint32_t number_of_messages= 0xFFFF;
+
+  pid_t child { fork() };
+  if( child == 0 )
+    {
+    //producer process maps queue at different address
+    int res{};
+      {
+      shm_queue_type producer{ shm_queue_type::open( name.c_str() ) };
+      for( uint32_t i{}; i != number_of_messages; )
+        if( producer.push( i ) )
+          ++i;
+        else
+          std::this_thread::yield();
+      }
+    _exit( res );
+    }
+  BOOST_REQUIRE( child > 0 );
+  uint32_t last_message_id{};
+  for( ; last_message_id != number_of_messages; ++last_message_id )
+    {
+    auto [ result, succeed ] = queue.pull_wait( 10000 );
+    BOOST_REQUIRE( succeed );
+    BOOST_TEST( result == last_message_id );
+    }
+  int status{};
+  waitpid( child, &status, 0 );
+  BOOST_TEST( WIFEXITED(status) );
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !queue.pull_wait( 1 ).second );
+  ampi::shm_region_t::unlink( name.c_str() );
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_shm_fifo_test_interprocess, * boost::unit_test::timeout(60) )
+{
+  shm_queue_interprocess_test<ampi::shm_fifo_t<uint32_t>>();
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_shm_ring_test_interprocess, * boost::unit_test::timeout(60) )
+{
+  shm_queue_interprocess_test<ampi::shm_ring_t<uint32_t>>();
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_shm_fifo_test_create_failure )
+{
+  using shm_queue_type = ampi::shm_fifo_t<uint32_t>;
+  std::string const name{ "/ampi_ut_fail_" + std::to_string( getpid() ) };
+  //capacity does not fit 32bit node index
+  BOOST_CHECK_THROW( shm_queue_type::create( name.c_str(), uint64_t{1} << 33 ), std::system_error );
+  //mapping fails, name is not left behind
+  BOOST_CHECK_THROW( ampi::shm_region_t::create( name.c_str(), std::size_t{1} << 62 ), std::system_error );
+  shm_queue_type queue{ shm_queue_type::create( name.c_str(), 16 ) };
+  BOOST_TEST( queue.push( 1u ) );
+  ampi::shm_region_t::unlink( name.c_str() );
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_shm_ring_test_memfd )
+{
+  using shm_queue_type = ampi::shm_ring_t<uint32_t>;
+  shm_queue_type queue{ shm_queue_type::create_anonymous( "ampi_ut", 16 ) };
+  //second mapping of the same memory at other address
+  shm_queue_type attached{ shm_queue_type::attach( dup( queue.native_handle() ) ) };
+  BOOST_TEST( queue.push( 7u ) );
+  auto [ result, succeed ] = attached.pull();
+  BOOST_TEST( succeed );
+  BOOST_TEST( result == 7u );
+  BOOST_TEST( queue.empty() );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using sharded_fifo_type = ampi::sharded_fifo_t<message_t>;
+BOOST_AUTO_TEST_CASE( lock_free_sharded_fifo_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  sharded_fifo_type queue{ 4 };
+  BOOST_TEST( queue.shard_count() == 4u );
+  BOOST_TEST( queue.empty() );
+  //single producer uses single shard so order is strict
+  for( uint32_t i{}; i != 1000; ++i )
+    ampi::push( queue, message_t{ i } );
+  BOOST_TEST( queue.size() == 1000 );
+  for( uint32_t i{}; i != 1000; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{ i }) );
+    }
+  BOOST_TEST( !ampi::pull( queue ).second );
+  BOOST_TEST( queue.empty() );
+  ampi::push( queue, message_t{ 1 } );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_sharded_fifo_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  sharded_fifo_type queue{ 8 };
+  constexpr uint32_t number_of_messages= 0xFFFF;
+  constexpr uint32_t number_of_senders = 4;
+  std::atomic<uint32_t> recived_count{};
+
+  auto fn_dequeue = [&]()
+                    {
+                    //order of messages from single producer is preserved
+                    std::array<uint32_t,number_of_senders> next_id{};
+                    std::array<bool,number_of_senders> first{ true, true, true, true };
+                    while( recived_count.load() != number_of_messages * number_of_senders )
+                      {
+                      auto [ result, succeed ] = ampi::pull( queue );
+                      if( succeed )
+                        {
+                        uint32_t const sender{ result.id >> 24 };
+                        uint32_t const id{ result.id & 0xFFFFFF };
+                        BOOST_TEST( (first[sender] || id > next_id[sender]) );
+                        first[sender] = false;
+                        next_id[sender] = id;
+                        recived_count.fetch_add( 1 );
+                        }
+                      else
+                        std::this_thread::yield();
+                      }
+                    };
+  auto fn_enqueue = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      ampi::push( queue, message_t{ (sender << 24) | i } );
+                    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue, i ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  for( auto & thread : threads )
+    thread.get();
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( queue.size() == 0 );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using faa_fifo_type = ampi::faa_fifo_t<message_t>;
+BOOST_AUTO_TEST_CASE( lock_free_faa_fifo_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  faa_fifo_type queue;
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !ampi::pull( queue ).second );
+  //cross several segments
+  uint32_t const number_of_messages { faa_fifo_type::segment_size * 3 + 7 };
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    ampi::push( queue, message_t{ i } );
+  BOOST_TEST( queue.size() == number_of_messages );
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{ i }) );
+    }
+  BOOST_TEST( !ampi::pull( queue ).second );
+  BOOST_TEST( queue.empty() );
+  for( uint32_t i{}; i != 100; ++i )
+    ampi::push( queue, message_t{ i } );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( lock_free_faa_fifo_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  faa_fifo_type queue;
+  constexpr uint32_t number_of_messages= 0x3FFFF;
+  constexpr uint32_t number_of_senders = 4;
+  std::atomic<uint32_t> recived_count{};
+  std::atomic<uint64_t> sum{};
+
+  auto fn_dequeue = [&]()
+                    {
+                    std::array<uint32_t,number_of_senders> last_id{};
+                    std::array<bool,number_of_senders> first{ true, true, true, true };
+                    while( recived_count.load() != number_of_messages * number_of_senders )
+                      {
+                      auto [ result, succeed ] = ampi::pull( queue );
+                      if( succeed )
+                        {
+                        uint32_t const sender{ result.id >> 24 };
+                        uint32_t const id{ result.id & 0xFFFFFF };
+                        BOOST_TEST( (first[sender] || id > last_id[sender]) );
+                        first[sender] = false;
+                        last_id[sender] = id;
+                        sum.fetch_add( id );
+                        recived_count.fetch_add( 1 );
+                        }
+                      else
+                        std::this_thread::yield();
+                      }
+                    };
+  auto fn_enqueue = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      ampi::push( queue, message_t{ (sender << 24) | i } );
+                    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue, i ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  for( auto & thread : threads )
+    thread.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  BOOST_TEST( sum.load() == expected_sum );
+  BOOST_TEST( queue.empty() );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( reclamation_domain_test_guard )
+{
+message_t::instance_counter  = 0;
+  {
+  ampi::reclamation_domain_t domain;
+    {
+    ampi::reclamation_domain_t::guard_t guard{ domain };
+    domain.retire( new message_t{ 1 } );
+    domain.reclaim();
+    //guard entered before retire protects node
+    BOOST_TEST( message_t::instance_counter == 1 );
+    }
+  domain.reclaim();
+  BOOST_TEST( message_t::instance_counter == 0 );
+
+  domain.retire( new message_t{ 2 } );
+    {
+    //guard entered after retire does not protect node
+    ampi::reclamation_domain_t::guard_t guard{ domain };
+    domain.reclaim();
+    BOOST_TEST( message_t::instance_counter == 0 );
+    }
+  domain.retire( new message_t{ 3 } );
+  }
+//domain frees remaining nodes
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using fc_fifo_type = ampi::fc_fifo_t<message_t>;
+BOOST_AUTO_TEST_CASE( fc_fifo_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  fc_fifo_type queue{ 4 };
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !ampi::pull( queue ).second );
+  for( uint32_t i{}; i != 100; ++i )
+    ampi::push( queue, message_t{ i } );
+  BOOST_TEST( queue.size() == 100 );
+  for( uint32_t i{}; i != 100; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{ i }) );
+    }
+  BOOST_TEST( queue.empty() );
+  ampi::push( queue, message_t{ 1 } );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+namespace
+{
+  struct throwing_move_t
+    {
+    static inline bool fail {};
+    uint32_t id {};
+    throwing_move_t() = default;
+    explicit throwing_move_t( uint32_t i ) : id{ i } {}
+    throwing_move_t( throwing_move_t const & ) = default;
+    throwing_move_t( throwing_move_t && rh ) : id{ rh.id } { if( fail ) throw std::runtime_error( "move" ); }
+    throwing_move_t & operator=( throwing_move_t const & ) = default;
+    throwing_move_t & operator=( throwing_move_t && ) = default;
+    };
+}
+
+BOOST_AUTO_TEST_CASE( fc_fifo_test_throwing_move )
+{
+  ampi::fc_fifo_t<throwing_move_t> queue{ 2 };
+  queue.push( throwing_move_t{ 1 } );
+  throwing_move_t::fail = true;
+  BOOST_CHECK_THROW( queue.push( throwing_move_t{ 2 } ), std::runtime_error );
+  throwing_move_t::fail = false;
+  //combiner lock was released
+  queue.push( throwing_move_t{ 3 } );
+  BOOST_TEST( queue.size() == 2 );
+  BOOST_TEST( queue.pull().first.id == 1u );
+  BOOST_TEST( queue.pull().first.id == 3u );
+}
+
+BOOST_AUTO_TEST_CASE( fc_fifo_test_oversubscribed, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  //more threads than publication slots
+  fc_fifo_type queue{ 2 };
+  constexpr uint32_t number_of_messages= 0xFFFF;
+  constexpr uint32_t number_of_senders = 4;
+  std::atomic<uint32_t> recived_count{};
+  std::atomic<uint64_t> sum{};
+
+  auto fn_dequeue = [&]()
+                    {
+                    std::array<uint32_t,number_of_senders> last_id{};
+                    std::array<bool,number_of_senders> first{ true, true, true, true };
+                    while( recived_count.load() != number_of_messages * number_of_senders )
+                      {
+                      auto [ result, succeed ] = ampi::pull( queue );
+                      if( succeed )
+                        {
+                        uint32_t const sender{ result.id >> 24 };
+                        uint32_t const id{ result.id & 0xFFFFFF };
+                        BOOST_TEST( (first[sender] || id > last_id[sender]) );
+                        first[sender] = false;
+                        last_id[sender] = id;
+                        sum.fetch_add( id );
+                        recived_count.fetch_add( 1 );
+                        }
+                      else
+                        std::this_thread::yield();
+                      }
+                    };
+  auto fn_enqueue = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      ampi::push( queue, message_t{ (sender << 24) | i } );
+                    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue, i ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  for( auto & thread : threads )
+    thread.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  BOOST_TEST( sum.load() == expected_sum );
+  BOOST_TEST( queue.empty() );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using wf_fifo_type = ampi::wf_fifo_t<message_t>;
+BOOST_AUTO_TEST_CASE( wf_fifo_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  wf_fifo_type queue{ 100, 4 };
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !ampi::pull( queue ).second );
+  for( uint32_t i{}; i != 100; ++i )
+    BOOST_TEST( queue.push( message_t{ i } ) );
+  BOOST_TEST( queue.size() == 100 );
+  for( uint32_t i{}; i != 100; ++i )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{ i }) );
+    }
+  BOOST_TEST( !ampi::pull( queue ).second );
+  BOOST_TEST( queue.empty() );
+  //nodes are recycled
+  for( uint32_t round{}; round != 10; ++round )
+    {
+    for( uint32_t i{}; i != 100; ++i )
+      BOOST_TEST( queue.push( message_t{ i } ) );
+    for( uint32_t i{}; i != 100; ++i )
+      BOOST_TEST( ampi::pull( queue ).first == (message_t{ i }) );
+    }
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( wf_fifo_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  constexpr uint32_t number_of_messages= 0xFFFF;
+  constexpr uint32_t number_of_senders = 4;
+  wf_fifo_type queue{ 1024, number_of_senders + 2 };
+  std::atomic<uint32_t> recived_count{};
+  std::atomic<uint64_t> sum{};
+
+  auto fn_dequeue = [&]()
+                    {
+                    std::array<uint32_t,number_of_senders> last_id{};
+                    std::array<bool,number_of_senders> first{ true, true, true, true };
+                    while( recived_count.load() != number_of_messages * number_of_senders )
+                      {
+                      auto [ result, succeed ] = ampi::pull( queue );
+                      if( succeed )
+                        {
+                        uint32_t const sender{ result.id >> 24 };
+                        uint32_t const id{ result.id & 0xFFFFFF };
+                        BOOST_TEST( (first[sender] || id > last_id[sender]) );
+                        first[sender] = false;
+                        last_id[sender] = id;
+                        sum.fetch_add( id );
+                        recived_count.fetch_add( 1 );
+                        }
+                      else
+                        std::this_thread::yield();
+                      }
+                    };
+  auto fn_enqueue = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      while( !queue.push( message_t{ (sender << 24) | i } ) )
+                        std::this_thread::yield();
+                    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue, i ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  for( auto & thread : threads )
+    thread.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  BOOST_TEST( sum.load() == expected_sum );
+  BOOST_TEST( queue.empty() );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using mpsc_type = ampi::mpsc_t<message_t>;
+BOOST_AUTO_TEST_CASE( mpsc_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  mpsc_type queue;
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !ampi::pull( queue ).second );
+  for( uint32_t round{}; round != 3; ++round )
+    {
+    for( uint32_t i{}; i != 100; ++i )
+      ampi::push( queue, message_t{ i } );
+    BOOST_TEST( queue.size() == 100 );
+    for( uint32_t i{}; i != 100; ++i )
+      {
+      auto [ result, succeed ] = ampi::pull( queue );
+      BOOST_TEST( succeed );
+      BOOST_TEST( result == (message_t{ i }) );
+      }
+    BOOST_TEST( !ampi::pull( queue ).second );
+    BOOST_TEST( queue.empty() );
+    }
+  ampi::push( queue, message_t{ 1 } );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( mpsc_test_intrusive )
+{
+  using node_type = ampi::mpsc_internal_tmpl<uint32_t>::node_type;
+  ampi::mpsc_internal_tmpl<uint32_t> queue;
+  std::array<node_type,8> nodes;
+  for( uint32_t i{}; i != nodes.size(); ++i )
+    {
+    nodes[i].value = i;
+    queue.push( &nodes[i] );
+    }
+  for( uint32_t i{}; i != nodes.size(); ++i )
+    BOOST_TEST( queue.pull() == &nodes[i] );
+  BOOST_TEST( queue.pull() == nullptr );
+  //node may be pushed again once pulled
+  queue.push( &nodes[0] );
+  BOOST_TEST( queue.pull() == &nodes[0] );
+}
+
+BOOST_AUTO_TEST_CASE( mpsc_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  mpsc_type queue;
+  constexpr uint32_t number_of_messages= 0x3FFFF;
+  constexpr uint32_t number_of_senders = 4;
+  uint64_t sum{};
+
+  auto fn_enqueue = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      ampi::push( queue, message_t{ (sender << 24) | i } );
+                    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue, i ) );
+  
+  std::array<uint32_t,number_of_senders> last_id{};
+  std::array<bool,number_of_senders> first{ true, true, true, true };
+  for( uint32_t recived_count{}; recived_count != number_of_messages * number_of_senders; )
+    {
+    auto [ result, succeed ] = ampi::pull( queue );
+    if( succeed )
+      {
+      uint32_t const sender{ result.id >> 24 };
+      uint32_t const id{ result.id & 0xFFFFFF };
+      BOOST_TEST( (first[sender] || id == last_id[sender] + 1) );
+      first[sender] = false;
+      last_id[sender] = id;
+      sum += id;
+      ++recived_count;
+      }
+    else
+      std::this_thread::yield();
+    }
+  for( auto & thread : threads )
+    thread.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  BOOST_TEST( sum == expected_sum );
+  BOOST_TEST( queue.empty() );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using priority_queue_type = ampi::priority_queue_t<uint32_t,message_t>;
+BOOST_AUTO_TEST_CASE( priority_queue_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  priority_queue_type queue{ ampi::default_reclamation_domain(), 4 };
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !queue.pull_min().second );
+  constexpr uint32_t number_of_messages = 1000;
+  //push in scrambled order
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    {
+    uint32_t const priority { (i * 7919) % number_of_messages };
+    queue.push( priority, message_t{ priority } );
+    }
+  BOOST_TEST( queue.size() == number_of_messages );
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    {
+    uint32_t priority;
+    message_t result;
+    BOOST_TEST( queue.pull_min( priority, result ) );
+    BOOST_TEST( priority == i );
+    BOOST_TEST( result == (message_t{ i }) );
+    }
+  BOOST_TEST( !queue.pull_min().second );
+  BOOST_TEST( queue.empty() );
+  queue.push( 1, message_t{ 1 } );
+  }
+ampi::default_reclamation_domain().reclaim();
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( priority_queue_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  ampi::reclamation_domain_t domain;
+  priority_queue_type queue{ domain };
+  constexpr uint32_t number_of_messages= 0xFFFF;
+  constexpr uint32_t number_of_senders = 4;
+  std::atomic<uint32_t> recived_count{};
+  std::atomic<uint64_t> sum{};
+
+  auto fn_dequeue = [&]()
+                    {
+                    while( recived_count.load() != number_of_messages * number_of_senders )
+                      {
+                      uint32_t priority;
+                      message_t result;
+                      if( queue.pull_min( priority, result ) )
+                        {
+                        BOOST_TEST( priority == result.id );
+                        sum.fetch_add( result.id & 0xFFFFFF );
+                        recived_count.fetch_add( 1 );
+                        }
+                      else
+                        std::this_thread::yield();
+                      }
+                    };
+  auto fn_enqueue = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      queue.push( (sender << 24) | i, message_t{ (sender << 24) | i } );
+                    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    threads.emplace_back( std::async(std::launch::async, fn_enqueue, i ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  threads.emplace_back( std::async(std::launch::async, fn_dequeue ) );
+  for( auto & thread : threads )
+    thread.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  BOOST_TEST( sum.load() == expected_sum );
+  BOOST_TEST( queue.empty() );
+}
+
+//---------------------------------------------------------------------------------------------
+
+using delay_queue_type = ampi::delay_queue_t<message_t>;
+BOOST_AUTO_TEST_CASE( delay_queue_test_single )
+{
+message_t::instance_counter  = 0;
+  {
+  using std::chrono::milliseconds;
+  delay_queue_type queue;
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !queue.pull().second );
+  auto const start { delay_queue_type::clock_type::now() };
+  //pushed in reverse deadline order
+  for( uint32_t i{5}; i != 0; --i )
+    queue.push( start + milliseconds{ 20 * i }, message_t{ i } );
+  queue.push( start - milliseconds{ 1 }, message_t{ 0 } );
+  BOOST_TEST( queue.size() == 6 );
+  //already due element is available immediately
+  BOOST_TEST( queue.pull().first == (message_t{ 0 }) );
+  BOOST_TEST( !queue.pull().second );
+  for( uint32_t i{1}; i != 6; ++i )
+    {
+    auto [ result, succeed ] = queue.pull_wait( 1000 );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == (message_t{ i }) );
+    //never released before deadline
+    BOOST_TEST( (delay_queue_type::clock_type::now() >= start + milliseconds{ 20 * i }) );
+    }
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( !queue.pull_wait( 10 ).second );
+  //deadlines far in future stay pending
+  queue.push_after( std::chrono::hours{ 24 * 100 }, message_t{ 1 } );
+  queue.push_after( std::chrono::seconds{ 70 }, message_t{ 2 } );
+  BOOST_TEST( !queue.pull().second );
+  BOOST_TEST( queue.size() == 2 );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( delay_queue_test_wakeup, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  delay_queue_type queue;
+  constexpr uint32_t number_of_messages = 2000;
+  //consumer sleeps with nothing pending and is woken by producer
+  auto receiver = std::async( std::launch::async, [&queue]
+                              {
+                              uint32_t recived_count{};
+                              while( recived_count != number_of_messages )
+                                if( queue.pull_wait( 5000 ).second )
+                                  ++recived_count;
+                                else
+                                  break;
+                              return recived_count;
+                              } );
+  ampi::sleep( 20 );
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    queue.push_after( std::chrono::microseconds{ (i * 37) % 3000 }, message_t{ i } );
+  BOOST_TEST( receiver.get() == number_of_messages );
+  BOOST_TEST( queue.empty() );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( delay_queue_test_cascade, * boost::unit_test::timeout(60) )
+{
+  using std::chrono::microseconds;
+  //fine tick spreads deadlines over several wheel levels
+  ampi::delay_queue_t<uint32_t> queue{ microseconds{ 1 } };
+  auto const start { delay_queue_type::clock_type::now() };
+  constexpr uint32_t number_of_messages = 10000;
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    queue.push( start + microseconds{ (i * 7919) % 300000 }, uint32_t{ i } );
+  uint32_t recived_count{};
+  while( recived_count != number_of_messages )
+    {
+    auto [ result, succeed ] = queue.pull_wait( 1000 );
+    BOOST_TEST( succeed );
+    if( !succeed )
+      break;
+    BOOST_TEST( (delay_queue_type::clock_type::now() >= start + microseconds{ (result * 7919) % 300000 }) );
+    ++recived_count;
+    }
+  BOOST_TEST( queue.empty() );
+}
+
+//---------------------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( select_test_any, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  ampi::eventcount_t eventcount;
+  ampi::notifying_queue_t<ampi::fifo_queue_t<message_t>> control{ eventcount };
+  ampi::notifying_queue_t<afifo_type> data{ eventcount };
+  ampi::notifying_queue_t<ampi::ring_t<message_t>> ring{ eventcount, 16 };
+  
+  BOOST_TEST( ampi::select( eventcount, 10, control, data, ring ) == -1 );
+  ampi::push( ring, message_t{ 3 } );
+  BOOST_TEST( ampi::select( eventcount, 10, control, data, ring ) == 2 );
+  //earlier queue has priority
+  ampi::push( control, message_t{ 1 } );
+  BOOST_TEST( ampi::select( eventcount, 10, control, data, ring ) == 0 );
+  ampi::pull( control );
+  ampi::pull( ring );
+  
+  //notifications for other queues do not extend timeout
+  std::atomic<bool> stop{};
+  auto notifier = std::async( std::launch::async, [&]
+                              {
+                              while( !stop.load() )
+                                {
+                                eventcount.notify();
+                                ampi::sleep( 1 );
+                                }
+                              } );
+  auto const start { std::chrono::steady_clock::now() };
+  BOOST_TEST( ampi::select( eventcount, 50, control, data ) == -1 );
+  BOOST_TEST( ( std::chrono::steady_clock::now() - start < std::chrono::seconds{ 5 } ) );
+  stop = true;
+  notifier.get();
+  
+  //consumer sleeps until producer pushes
+  auto consumer = std::async( std::launch::async, [&]
+                              {
+                              uint32_t recived_count{};
+                              while( recived_count != 100 )
+                                {
+                                int const index { ampi::select( eventcount, -1, control, data ) };
+                                if( index == 0 && ampi::pull( control ).second )
+                                  ++recived_count;
+                                else if( index == 1 )
+                                  {
+                                  auto [ it, succeed ] = ampi::pull( data );
+                                  while( !it.empty() )
+                                    if( ampi::pull( it ).second )
+                                      ++recived_count;
+                                  }
+                                }
+                              return recived_count;
+                              } );
+  for( uint32_t i{}; i != 50; ++i )
+    {
+    ampi::push( control, message_t{ i } );
+    ampi::push( data, message_t{ i } );
+    if( i % 10 == 0 )
+      ampi::sleep( 1 );
+    }
+  BOOST_TEST( consumer.get() == 100 );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( eventfd_queue_test_epoll, * boost::unit_test::timeout(60) )
+{
+message_t::instance_counter  = 0;
+  {
+  ampi::eventfd_queue_t<ampi::fifo_queue_t<message_t>> queue;
+  int const epoll_fd { epoll_create1( EPOLL_CLOEXEC ) };
+  BOOST_REQUIRE( epoll_fd != -1 );
+  epoll_event event{};
+  event.events = EPOLLIN;
+  BOOST_REQUIRE( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, queue.native_handle(), &event ) == 0 );
+  
+  //nothing signalled while queue is empty
+  BOOST_TEST( epoll_wait( epoll_fd, &event, 1, 0 ) == 0 );
+  //only transition to non empty signals
+  ampi::push( queue, message_t{ 0 } );
+  ampi::push( queue, message_t{ 1 } );
+  BOOST_TEST( epoll_wait( epoll_fd, &event, 1, 0 ) == 1 );
+  BOOST_TEST( ampi::pull( queue ).second );
+  BOOST_TEST( !queue.rearm() );
+  BOOST_TEST( ampi::pull( queue ).second );
+  BOOST_TEST( queue.rearm() );
+  BOOST_TEST( epoll_wait( epoll_fd, &event, 1, 0 ) == 0 );
+  
+  constexpr uint32_t number_of_messages = 0xFFFF;
+  auto loop = std::async( std::launch::async, [&]
+                          {
+                          uint32_t recived_count{};
+                          uint32_t wakeups{};
+                          while( recived_count != number_of_messages )
+                            {
+                            epoll_event ev;
+                            if( epoll_wait( epoll_fd, &ev, 1, 1000 ) != 1 )
+                              break;
+                            ++wakeups;
+                            do
+                              while( ampi::pull( queue ).second )
+                                ++recived_count;
+                            while( !queue.rearm() );
+                            }
+                          BOOST_TEST( wakeups <= recived_count );
+                          return recived_count;
+                          } );
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    ampi::push( queue, message_t{ i } );
+  BOOST_TEST( loop.get() == number_of_messages );
+  close( epoll_fd );
+  }
+BOOST_TEST( message_t::instance_counter == 0 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( broadcast_ring_test_single )
+{
+  ampi::broadcast_ring_t<uint32_t> ring{ 8, 2 };
+  int const first { ring.subscribe() };
+  int const second { ring.subscribe() };
+  BOOST_TEST( first != second );
+  BOOST_TEST( ring.subscribe() == ring.no_consumer );
+  BOOST_TEST( ring.peek( first ) == nullptr );
+  for( uint32_t i{}; i != 8; ++i )
+    ring.push( i );
+  //every consumer sees every message in place
+  for( uint32_t i{}; i != 8; ++i )
+    {
+    auto [ result, succeed ] = ring.pull( first );
+    BOOST_TEST( succeed );
+    BOOST_TEST( result == i );
+    }
+  BOOST_TEST( !ring.pull( first ).second );
+  BOOST_TEST( *ring.peek( second ) == 0u );
+  BOOST_TEST( ring.peek( second ) == ring.peek( second ) );
+  uint32_t sum{};
+  BOOST_TEST( ring.consume( second, [&sum]( uint32_t value ){ sum += value; } ) == 8u );
+  BOOST_TEST( sum == 28u );
+  //late subscriber starts with next message
+  ring.unsubscribe( second );
+  ring.push( 8 );
+  int const third { ring.subscribe() };
+  BOOST_TEST( !ring.pull( third ).second );
+  ring.push( 9 );
+  BOOST_TEST( ring.pull( third ).first == 9u );
+  BOOST_TEST( ring.pull( first ).first == 8u );
+}
+
+template<ampi::producer_mode mode>
+static void broadcast_ring_test_threads( uint32_t number_of_senders )
+{
+  constexpr uint32_t number_of_messages= 0x3FFFF;
+  constexpr uint32_t number_of_consumers = 3;
+  ampi::broadcast_ring_t<uint32_t,mode> ring{ 256, number_of_consumers };
+  std::array<int,number_of_consumers> consumers;
+  for( int & consumer : consumers )
+    consumer = ring.subscribe();
+  
+  auto fn_consume = [&]( int consumer )
+                    {
+                    std::array<uint32_t,4> next_id{};
+                    uint64_t sum{};
+                    for( uint32_t recived_count{}; recived_count != number_of_messages * number_of_senders; )
+                      {
+                      uint64_t const count { ring.consume( consumer, [&]( uint32_t value )
+                                                          {
+                                                          uint32_t const sender{ value >> 24 };
+                                                          uint32_t const id{ value & 0xFFFFFF };
+                                                          BOOST_TEST( id == next_id[sender] );
+                                                          next_id[sender] = id + 1;
+                                                          sum += id;
+                                                          } ) };
+                      if( count == 0 )
+                        std::this_thread::yield();
+                      recived_count += count;
+                      }
+                    return sum;
+                    };
+  auto fn_produce = [&]( uint32_t sender )
+                    {
+                    for( uint32_t i{}; i != number_of_messages; ++i )
+                      ring.push( (sender << 24) | i );
+                    };
+  std::vector<std::future<uint64_t>> receivers;
+  for( int consumer : consumers )
+    receivers.emplace_back( std::async(std::launch::async, fn_consume, consumer ) );
+  std::vector<std::future<void>> senders;
+  for( uint32_t i{}; i != number_of_senders; ++i )
+    senders.emplace_back( std::async(std::launch::async, fn_produce, i ) );
+  for( auto & sender : senders )
+    sender.get();
+  uint64_t const expected_sum { ((uint64_t(number_of_messages)-1)*number_of_messages)/2 * number_of_senders };
+  for( auto & receiver : receivers )
+    BOOST_TEST( receiver.get() == expected_sum );
+}
+
+BOOST_AUTO_TEST_CASE( broadcast_ring_test_single_producer, * boost::unit_test::timeout(60) )
+{
+  broadcast_ring_test_threads<ampi::producer_mode::single>( 1 );
+}
+
+BOOST_AUTO_TEST_CASE( broadcast_ring_test_multi_producer, * boost::unit_test::timeout(60) )
+{
+  broadcast_ring_test_threads<ampi::producer_mode::multi>( 4 );
+}
+
+//---------------------------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_CASE( pipeline_ring_test_stages, * boost::unit_test::timeout(60) )
+{
+  struct record_t
+    {
+    uint32_t raw;
+    uint32_t decoded;
+    uint32_t enriched;
+    };
+  constexpr uint32_t number_of_messages= 0x3FFFF;
+  constexpr uint32_t batch = 16;
+  ampi::pipeline_ring_t<record_t> ring{ 1024, 3 };
+  int const decode { ring.add_stage() };
+  int const enrich { ring.add_stage( { decode } ) };
+  int const publish { ring.add_stage( { enrich } ) };
+  BOOST_TEST( ring.available( decode ) == 0u );
+    {
+    //empty upstream list follows producer
+    ampi::pipeline_ring_t<record_t> other{ 8, 1 };
+    int const stage { other.add_stage( {} ) };
+    BOOST_TEST( other.available( stage ) == 0u );
+    other.publish( other.claim( 2 ), 2 );
+    BOOST_TEST( other.available( stage ) == 2u );
+    }
+  
+  auto run_stage = [&]( int stage, auto const & fn )
+                    {
+                    for( uint64_t processed{}; processed != number_of_messages; )
+                      {
+                      uint64_t const count { ring.process( stage, fn, batch ) };
+                      if( count == 0 )
+                        std::this_thread::yield();
+                      processed += count;
+                      }
+                    };
+  auto decoder = std::async( std::launch::async, run_stage, decode,
+                             []( record_t & record, uint64_t ){ record.decoded = record.raw * 2; } );
+  auto enricher = std::async( std::launch::async, run_stage, enrich,
+                              []( record_t & record, uint64_t ){ record.enriched = record.decoded + 1; } );
+  uint64_t sum{};
+  bool in_order{ true };
+  auto publisher = std::async( std::launch::async, run_stage, publish,
+                               [&]( record_t const & record, uint64_t sequence )
+                                 {
+                                 in_order = in_order && record.raw == sequence && record.enriched == record.raw * 2 + 1;
+                                 sum += record.raw;
+                                 } );
+  //producer claims batches of cells and fills them in place
+  for( uint32_t i{}; i != number_of_messages; )
+    {
+    uint32_t const count { std::min( batch, number_of_messages - i ) };
+    uint64_t const first { ring.claim( count ) };
+    for( uint32_t j{}; j != count; ++j )
+      ring[ first + j ] = record_t{ i + j, 0, 0 };
+    ring.publish( first, count );
+    i += count;
+    }
+  decoder.get();
+  enricher.get();
+  publisher.get();
+  BOOST_TEST( in_order );
+  BOOST_TEST( sum == ((uint64_t(number_of_messages)-1)*number_of_messages)/2 );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( conflating_queue_test_single )
+{
+  using queue_type = ampi::conflating_queue_t<uint32_t,std::string>;
+  queue_type queue{ 4 };
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( queue.push( 1, std::string{"a1"} ) );
+  BOOST_TEST( queue.push( 2, std::string{"b1"} ) );
+  BOOST_TEST( queue.push( 1, std::string{"a2"} ) );
+  BOOST_TEST( queue.size() == 2 );
+  BOOST_TEST( queue.conflated() == 1 );
+  //key keeps position it got when it became dirty
+  auto [first, first_ok] = queue.pull();
+  BOOST_TEST( first_ok );
+  BOOST_TEST( first.first == 1u );
+  BOOST_TEST( first.second == "a2" );
+  BOOST_TEST( queue.push( 1, std::string{"a3"} ) );
+  auto [second, second_ok] = queue.pull();
+  BOOST_TEST( second_ok );
+  BOOST_TEST( second.first == 2u );
+  BOOST_TEST( second.second == "b1" );
+  auto [third, third_ok] = queue.pull();
+  BOOST_TEST( third_ok );
+  BOOST_TEST( third.second == "a3" );
+  BOOST_TEST( !queue.pull().second );
+  //key table is bounded
+  BOOST_TEST( queue.push( 3, std::string{"c"} ) );
+  BOOST_TEST( queue.push( 4, std::string{"d"} ) );
+  BOOST_TEST( !queue.push( 5, std::string{"e"} ) );
+  BOOST_TEST( queue.key_count() == 4u );
+  //pending values are released by destructor
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( conflating_queue_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  constexpr uint32_t number_of_keys { 64 };
+  constexpr uint32_t updates_per_key { 20000 };
+  constexpr uint32_t number_of_producers { 4 };
+  using queue_type = ampi::conflating_queue_t<uint32_t,uint64_t>;
+  queue_type queue{ number_of_keys };
+
+  //every producer owns subset of keys and publishes increasing versions
+  auto producer = [&queue]( uint32_t producer_index )
+    {
+    for( uint64_t version{1}; version <= updates_per_key; ++version )
+      for( uint32_t key{ producer_index }; key < number_of_keys; key += number_of_producers )
+        queue.push( key, version );
+    };
+  std::vector<std::future<void>> producers;
+  for( uint32_t i{}; i != number_of_producers; ++i )
+    producers.emplace_back( std::async( std::launch::async, producer, i ) );
+
+  std::vector<uint64_t> last( number_of_keys );
+  bool monotonic { true };
+  auto consume = [&]
+    {
+    uint32_t key;
+    uint64_t version;
+    while( queue.pull( key, version ) )
+      {
+      monotonic = monotonic && version > last[key];
+      last[key] = version;
+      }
+    };
+  while( std::any_of( producers.begin(), producers.end(),
+                      []( std::future<void> & f ){ return f.wait_for( std::chrono::seconds{} ) != std::future_status::ready; } ) )
+    consume();
+  consume();
+  BOOST_TEST( monotonic );
+  BOOST_TEST( std::all_of( last.begin(), last.end(), []( uint64_t version ){ return version == updates_per_key; } ) );
+  BOOST_TEST( queue.empty() );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( object_pool_test_single )
+{
+  ampi::object_pool_t<std::vector<char>> pool{ 4, 2 };
+  pool.reserve( 6, std::size_t{128} );
+  BOOST_TEST( pool.allocated() == 6 );
+  char * data;
+    {
+    auto buffer { pool.acquire() };
+    BOOST_TEST( bool(buffer) );
+    BOOST_TEST( buffer->size() == 128u );
+    data = buffer->data();
+    }
+  //released object is reused from cache in released state
+    {
+    auto buffer { pool.acquire() };
+    BOOST_TEST( buffer->data() == data );
+    }
+  std::vector<ampi::object_pool_t<std::vector<char>>::handle_type> handles;
+  for( int i{}; i != 10; ++i )
+    handles.emplace_back( pool.acquire( std::size_t{16} ) );
+  BOOST_TEST( pool.allocated() == 10 );
+  handles.clear();
+  pool.flush();
+  handles.emplace_back( pool.acquire() );
+  BOOST_TEST( pool.allocated() == 10 );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( object_pool_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  struct connection_t { std::atomic<uint32_t> users{}; uint64_t uses{}; };
+  constexpr uint32_t number_of_threads { 6 };
+  constexpr uint32_t iterations { 100000 };
+  ampi::object_pool_t<connection_t> pool{ 8, 4 };
+  std::atomic<bool> exclusive{ true };
+
+  auto worker = [&]
+    {
+    std::vector<ampi::object_pool_t<connection_t>::handle_type> held;
+    for( uint32_t i{}; i != iterations; ++i )
+      {
+      auto handle { pool.acquire() };
+      //object is never handed out twice at the same time
+      if( handle->users.fetch_add( 1 ) != 0 )
+        exclusive = false;
+      ++handle->uses;
+      handle->users.fetch_sub( 1 );
+      if( i % 3 == 0 )
+        held.emplace_back( std::move(handle) );
+      if( held.size() > 20 )
+        held.clear();
+      }
+    };
+  std::vector<std::future<void>> workers;
+  for( uint32_t i{}; i != number_of_threads; ++i )
+    workers.emplace_back( std::async( std::launch::async, worker ) );
+  for( auto & w : workers )
+    w.get();
+  BOOST_TEST( exclusive.load() );
+  BOOST_TEST( pool.allocated() <= long( number_of_threads * 40 ) );
+}
+//----------------------------------------------------------------------------------------------------------------------
+namespace
+{
+  struct counting_resource_t : public std::pmr::memory_resource
+    {
+    std::atomic<long> outstanding{};
+    std::atomic<long> allocations{};
+    //number of allocations which succeed before bad_alloc, negative never fails
+    std::atomic<long> fail_after{ -1 };
+
+    void * do_allocate( std::size_t bytes, std::size_t alignment ) override
+      {
+      if( fail_after.load() == 0 )
+        throw std::bad_alloc{};
+      if( fail_after.load() > 0 )
+        --fail_after;
+      ++allocations;
+      ++outstanding;
+      return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+      }
+    void do_deallocate( void * p, std::size_t bytes, std::size_t alignment ) override
+      {
+      --outstanding;
+      std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+      }
+    bool do_is_equal( std::pmr::memory_resource const & other ) const noexcept override { return this == &other; }
+    };
+
+  template<typename queue_type, typename ... args_type>
+  void pmr_queue_test( counting_resource_t & resource, args_type ... args )
+    {
+      {
+      queue_type queue{ args..., &resource };
+      for( uint32_t i{}; i != 100; ++i )
+        queue.push( uint32_t{ i } );
+      BOOST_TEST( resource.allocations.load() >= 100 );
+      auto [value, success] = queue.pull();
+      BOOST_TEST( success );
+      (void)value;
+      //remaining elements are released to resource by destructor
+      }
+    BOOST_TEST( resource.outstanding.load() == 0 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( pmr_containers_test )
+{
+  counting_resource_t stack_resource, mpsc_resource, fifo_resource, afifo_resource;
+  pmr_queue_test<ampi::pmr::stack_t<uint32_t>>( stack_resource );
+  pmr_queue_test<ampi::pmr::mpsc_t<uint32_t>>( mpsc_resource );
+  pmr_queue_test<ampi::pmr::fifo_queue_t<uint32_t>>( fifo_resource );
+    {
+    ampi::pmr::afifo_t<uint32_t> queue{ &afifo_resource };
+    for( uint32_t i{}; i != 100; ++i )
+      queue.push( uint32_t{ i } );
+    BOOST_TEST( afifo_resource.outstanding.load() == 100 );
+    ampi::pmr::afifo_t<uint32_t>::drain_iterator_type drained;
+    drained = queue.drain();
+    BOOST_TEST( drained.pull().second );
+    }
+  BOOST_TEST( afifo_resource.outstanding.load() == 0 );
+
+  //allocator comes after container specific parameters
+  counting_resource_t sharded_resource, faa_resource, fc_resource;
+  pmr_queue_test<ampi::pmr::sharded_fifo_t<uint32_t>>( sharded_resource, 4u );
+  pmr_queue_test<ampi::pmr::faa_fifo_t<uint32_t>>( faa_resource );
+    {
+    //deque allocates blocks of elements
+    ampi::pmr::fc_fifo_t<uint32_t> queue{ 4, &fc_resource };
+    for( uint32_t i{}; i != 1000; ++i )
+      queue.push( i );
+    BOOST_TEST( fc_resource.outstanding.load() > 0 );
+    BOOST_TEST( queue.pull().first == 0u );
+    }
+  BOOST_TEST( fc_resource.outstanding.load() == 0 );
+
+  counting_resource_t priority_resource, delay_resource, conflating_resource;
+    {
+    //retired nodes are freed by domain, resource must outlive it
+    ampi::reclamation_domain_t domain;
+    ampi::pmr::priority_queue_t<uint32_t,uint32_t> queue{ domain, 4, &priority_resource };
+    for( uint32_t i{}; i != 100; ++i )
+      queue.push( 100 - i, i );
+    BOOST_TEST( priority_resource.outstanding.load() >= 100 );
+    //pulled prefix is retired to domain
+    for( uint32_t i{}; i != 50; ++i )
+      BOOST_TEST_REQUIRE( queue.pull_min().first == 99 - i );
+    }
+  BOOST_TEST( priority_resource.outstanding.load() == 0 );
+    {
+    ampi::pmr::delay_queue_t<uint32_t> queue{ std::chrono::milliseconds{1}, &delay_resource };
+    for( uint32_t i{}; i != 100; ++i )
+      queue.push_after( std::chrono::hours{ 1 + i }, i );
+    queue.push_after( std::chrono::milliseconds{}, 100u );
+    BOOST_TEST( delay_resource.allocations.load() >= 100 );
+    BOOST_TEST( queue.pull_wait( 1000 ).first == 100u );
+    }
+  BOOST_TEST( delay_resource.outstanding.load() == 0 );
+    {
+    ampi::pmr::conflating_queue_t<uint32_t,uint32_t> queue{ 16, std::hash<uint32_t>{}, &conflating_resource };
+    for( uint32_t i{}; i != 100; ++i )
+      queue.push( i % 4, i );
+    BOOST_TEST( conflating_resource.outstanding.load() == 4 );
+    BOOST_TEST( queue.pull().first.second == 96u );
+    BOOST_TEST( conflating_resource.outstanding.load() == 3 );
+    }
+  BOOST_TEST( conflating_resource.outstanding.load() == 0 );
+
+  //monotonic per request buffer
+  std::array<std::byte,16384> buffer;
+  std::pmr::monotonic_buffer_resource request_resource{ buffer.data(), buffer.size(), std::pmr::null_memory_resource() };
+  ampi::pmr::mpsc_t<uint64_t> mailbox{ &request_resource };
+  for( uint64_t i{}; i != 64; ++i )
+    mailbox.push( uint64_t{ i } );
+  BOOST_TEST( mailbox.pull().first == 0u );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( huge_page_resource_test )
+{
+  counting_resource_t upstream;
+    {
+    ampi::huge_page_resource_t arena{ 1 << 20, &upstream };
+    BOOST_TEST( arena.capacity() >= std::size_t{1 << 20} );
+      {
+      ampi::pmr::fifo_queue_t<uint64_t> queue{ &arena };
+      for( uint64_t i{}; i != 1000; ++i )
+        queue.push( uint64_t{ i } );
+      std::size_t const used { arena.used() };
+      BOOST_TEST( used > 0u );
+      //nodes freed by pull are reused, region does not grow under steady churn
+      for( uint64_t i{}; i != 100000; ++i )
+        {
+        auto [value, success] = queue.pull();
+        BOOST_TEST_REQUIRE( success );
+        BOOST_TEST_REQUIRE( value == i );
+        queue.push( uint64_t{ i + 1000 } );
+        }
+      BOOST_TEST( arena.used() <= used + 1024 * 64 );
+      }
+    BOOST_TEST( upstream.allocations.load() == 0 );
+    //exhausted region falls back to upstream
+    std::vector<void *> blocks;
+    while( upstream.allocations.load() == 0 )
+      blocks.emplace_back( arena.allocate( 1024, 8 ) );
+    BOOST_TEST( arena.used() == arena.capacity() );
+    for( void * block : blocks )
+      arena.deallocate( block, 1024, 8 );
+    BOOST_TEST( upstream.outstanding.load() == 0 );
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( numa_fifo_test, * boost::unit_test::timeout(60) )
+{
+  BOOST_TEST( ampi::numa_node_count() >= 1u );
+  BOOST_TEST( ampi::this_numa_node() < ampi::numa_node_count() );
+  BOOST_TEST( ampi::numa_node_has_memory( ampi::this_numa_node() ) );
+
+  //sysfs list with hole, missing list gives no nodes
+  std::string const list_path { "/tmp/ampi_numa_list_" + std::to_string( ::getpid() ) };
+  if( FILE * file = std::fopen( list_path.c_str(), "w" ) )
+    {
+    std::fputs( "0,2-3\n", file );
+    std::fclose( file );
+    std::vector<bool> const nodes { ampi::read_numa_node_list( list_path.c_str() ) };
+    BOOST_TEST( ( nodes == std::vector<bool>{ true, false, true, true } ) );
+    std::remove( list_path.c_str() );
+    }
+  BOOST_TEST( ampi::read_numa_node_list( list_path.c_str() ).empty() );
+
+  ampi::numa_resource_t resource{ 1 << 20 };
+  BOOST_TEST( resource.node_count() == ampi::numa_node_count() );
+  void * block { resource.allocate( 64, 8 ) };
+  //block is carved from region of node allocating thread runs on
+  BOOST_TEST( resource.home_node( block ) < resource.node_count() );
+  resource.deallocate( block, 64, 8 );
+
+  constexpr uint32_t number_of_threads { 4 };
+  constexpr uint32_t number_of_messages { 20000 };
+  ampi::numa_fifo_t<uint32_t> queue{ 16 << 20 };
+  auto producer = [&queue]
+    {
+    for( uint32_t i{}; i != number_of_messages; ++i )
+      queue.push( i );
+    };
+  std::vector<std::future<void>> producers;
+  for( uint32_t i{}; i != number_of_threads; ++i )
+    producers.emplace_back( std::async( std::launch::async, producer ) );
+  uint64_t sum{};
+  uint32_t received{};
+  while( received != number_of_threads * number_of_messages )
+    if( auto [value, success] = queue.pull(); success )
+      {
+      sum += value;
+      ++received;
+      }
+  for( auto & p : producers )
+    p.get();
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( sum == uint64_t(number_of_threads) * ((uint64_t(number_of_messages)-1)*number_of_messages)/2 );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( fifo_queue_test_reserve_trim )
+{
+  counting_resource_t resource;
+    {
+    ampi::pmr::fifo_queue_t<uint32_t> queue{ ampi::fifo_cache_config_t{ 16, 64 }, &resource };
+    queue.reserve( 100 );
+    BOOST_TEST( queue.spare_size() == 100 );
+    long const allocations { resource.allocations.load() };
+    //nodes come from spare list, only envelopes are allocated
+    for( uint32_t i{}; i != 50; ++i )
+      queue.push( i );
+    BOOST_TEST( resource.allocations.load() - allocations == 50 );
+    BOOST_TEST( queue.spare_size() == 50 );
+    for( uint32_t i{}; i != 50; ++i )
+      BOOST_TEST( queue.pull().first == i );
+    //nodes leaving reclaim table return to spare list
+    BOOST_TEST( queue.spare_size() > 50 );
+    long const outstanding { resource.outstanding.load() };
+    BOOST_TEST( queue.trim() > 50 );
+    BOOST_TEST( queue.spare_size() == 0 );
+    BOOST_TEST( resource.outstanding.load() < outstanding );
+    }
+  BOOST_TEST( resource.outstanding.load() == 0 );
+
+  //tiny mode keeps no spare nodes
+  ampi::fifo_queue_t<uint32_t> tiny{ ampi::fifo_cache_config_t::tiny() };
+  for( uint32_t round{}; round != 3; ++round )
+    {
+    for( uint32_t i{}; i != 100; ++i )
+      tiny.push( i );
+    for( uint32_t i{}; i != 100; ++i )
+      BOOST_TEST_REQUIRE( tiny.pull().first == i );
+    }
+  BOOST_TEST( tiny.spare_size() == 0 );
+  BOOST_TEST( tiny.empty() );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( mailbox_test_single )
+{
+  static_assert( sizeof(ampi::mailbox_t<std::string>) == 2 * sizeof(void *) );
+  static_assert( sizeof(ampi::mpsc_mailbox_t<std::string>) == 2 * sizeof(void *) );
+  ampi::mailbox_t<std::string> mailbox;
+  BOOST_TEST( mailbox.empty() );
+  BOOST_TEST( !mailbox.pull().second );
+  mailbox.push( std::string{"a"} );
+  mailbox.push( std::string{"b"} );
+  BOOST_TEST( !mailbox.empty() );
+  BOOST_TEST( mailbox.pull().first == "a" );
+  BOOST_TEST( mailbox.pull().first == "b" );
+  BOOST_TEST( mailbox.empty() );
+  mailbox.push( std::string{"left for destructor"} );
+
+  ampi::mpsc_mailbox_t<std::string> mpsc;
+  BOOST_TEST( mpsc.empty() );
+  mpsc.push( std::string{"a"} );
+  mpsc.push( std::string{"b"} );
+  BOOST_TEST( mpsc.pull().first == "a" );
+  mpsc.push( std::string{"c"} );
+  BOOST_TEST( mpsc.pull().first == "b" );
+  BOOST_TEST( mpsc.pull().first == "c" );
+  BOOST_TEST( mpsc.empty() );
+  mpsc.push( std::string{"left for destructor"} );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( mailbox_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  constexpr uint32_t number_of_threads { 3 };
+  constexpr uint32_t number_of_messages { 50000 };
+  constexpr uint32_t number_of_mailboxes { 64 };
+  //many mailboxes are created, only some see traffic
+  std::vector<ampi::mailbox_t<uint32_t>> mailboxes( number_of_mailboxes * 16 );
+  ampi::mpsc_mailbox_t<uint32_t> mpsc;
+
+  auto producer = [&]( uint32_t thread_id )
+    {
+    for( uint32_t i{}; i != number_of_messages; ++i )
+      {
+      mailboxes[ ( i % number_of_mailboxes ) * 16 ].push( ( thread_id << 24 ) | i );
+      mpsc.push( ( thread_id << 24 ) | i );
+      }
+    };
+  std::atomic<uint64_t> mpmc_sum{};
+  std::atomic<uint32_t> mpmc_received{};
+  auto consumer = [&]
+    {
+    while( mpmc_received.load() != number_of_threads * number_of_messages )
+      for( uint32_t box{}; box != number_of_mailboxes; ++box )
+        if( auto [value, success] = mailboxes[ box * 16 ].pull(); success )
+          {
+          mpmc_sum += value & 0xFFFFFF;
+          ++mpmc_received;
+          }
+    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_threads; ++i )
+    threads.emplace_back( std::async( std::launch::async, producer, i ) );
+  for( uint32_t i{}; i != 2; ++i )
+    threads.emplace_back( std::async( std::launch::async, consumer ) );
+
+  //mpsc keeps per producer order
+  std::vector<uint32_t> next( number_of_threads );
+  bool in_order { true };
+  for( uint32_t received{}; received != number_of_threads * number_of_messages; )
+    if( auto [value, success] = mpsc.pull(); success )
+      {
+      in_order = in_order && ( value & 0xFFFFFF ) == next[ value >> 24 ]++;
+      ++received;
+      }
+  for( auto & t : threads )
+    t.get();
+  BOOST_TEST( in_order );
+  BOOST_TEST( mpmc_sum.load() == uint64_t(number_of_threads) * ((uint64_t(number_of_messages)-1)*number_of_messages)/2 );
+  BOOST_TEST( std::all_of( mailboxes.begin(), mailboxes.end(), []( auto const & m ){ return m.empty(); } ) );
+}
+//----------------------------------------------------------------------------------------------------------------------
+namespace
+{
+  //constant initialized, usable from static constructors of other translation units
+  ampi::static_fifo_t<uint32_t,1024> static_fifo;
+  ampi::static_mpsc_t<uint32_t,1024> static_mpsc;
+  ampi::static_stack_t<uint32_t,512> static_stack;
+}
+
+BOOST_AUTO_TEST_CASE( static_containers_test_single )
+{
+  static_assert( decltype(static_fifo)::capacity() == 1024 );
+  static_assert( decltype(static_stack)::capacity() == 512 );
+  BOOST_TEST( static_fifo.empty() );
+  for( uint32_t i{}; i != 1024; ++i )
+    BOOST_TEST_REQUIRE( static_fifo.push( i ) );
+  BOOST_TEST( !static_fifo.push( 1024u ) );
+  for( uint32_t i{}; i != 1024; ++i )
+    BOOST_TEST_REQUIRE( static_fifo.pull().first == i );
+  BOOST_TEST( !static_fifo.pull().second );
+
+  for( uint32_t i{}; i != 512; ++i )
+    BOOST_TEST_REQUIRE( static_stack.push( i ) );
+  BOOST_TEST( !static_stack.push( 512u ) );
+  BOOST_TEST( static_stack.size() == 512 );
+  for( uint32_t i{ 512 }; i != 0; --i )
+    BOOST_TEST_REQUIRE( static_stack.pull().first == i - 1 );
+  BOOST_TEST( static_stack.empty() );
+  //freed nodes are reused
+  BOOST_TEST( static_stack.push( 7u ) );
+  BOOST_TEST( static_stack.pull().first == 7u );
+}
+
+template<typename queue_type>
+static void static_queue_test_threads( queue_type & queue, uint32_t number_of_consumers )
+{
+  constexpr uint32_t number_of_producers { 3 };
+  constexpr uint32_t number_of_messages { 100000 };
+  auto producer = [&queue]( uint32_t thread_id )
+    {
+    for( uint32_t i{}; i != number_of_messages; )
+      if( queue.push( ( thread_id << 24 ) | i ) )
+        ++i;
+      else
+        std::this_thread::yield();
+    };
+  std::atomic<uint32_t> received{};
+  std::atomic<uint64_t> sum{};
+  auto consumer = [&]
+    {
+    while( received.load() != number_of_producers * number_of_messages )
+      if( auto [value, success] = queue.pull(); success )
+        {
+        sum += value & 0xFFFFFF;
+        ++received;
+        }
+    };
+  std::vector<std::future<void>> threads;
+  for( uint32_t i{}; i != number_of_producers; ++i )
+    threads.emplace_back( std::async( std::launch::async, producer, i ) );
+  for( uint32_t i{}; i != number_of_consumers; ++i )
+    threads.emplace_back( std::async( std::launch::async, consumer ) );
+  for( auto & t : threads )
+    t.get();
+  BOOST_TEST( sum.load() == uint64_t(number_of_producers) * ((uint64_t(number_of_messages)-1)*number_of_messages)/2 );
+  BOOST_TEST( queue.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( static_containers_test_multiple_threads, * boost::unit_test::timeout(120) )
+{
+  static_queue_test_threads( static_fifo, 2 );
+  static_queue_test_threads( static_mpsc, 1 );
+  static_queue_test_threads( static_stack, 2 );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( write_combiner_test_single )
+{
+  ampi::fifo_queue_t<uint32_t> queue;
+    {
+    ampi::write_combiner_t<ampi::fifo_queue_t<uint32_t>> combiner{ queue, 100, std::chrono::hours{1} };
+    for( uint32_t i{}; i != 250; ++i )
+      combiner.push( i );
+    //two full batches published, rest staged
+    BOOST_TEST( queue.size() == 200 );
+    BOOST_TEST( combiner.staged() == 50u );
+    }
+  //destructor flushes
+  BOOST_TEST( queue.size() == 250 );
+  for( uint32_t i{}; i != 250; ++i )
+    BOOST_TEST_REQUIRE( queue.pull().first == i );
+
+  //latency budget
+  ampi::write_combiner_t<ampi::fifo_queue_t<uint32_t>> combiner{ queue, 100, std::chrono::milliseconds{1} };
+  combiner.push( 1u );
+  BOOST_TEST( queue.empty() );
+  std::this_thread::sleep_for( std::chrono::milliseconds{2} );
+  combiner.flush_if_due();
+  BOOST_TEST( queue.size() == 1 );
+  //push checks clock once per interval
+  using combiner_type = decltype(combiner);
+  combiner.push( 2u );
+  std::this_thread::sleep_for( std::chrono::milliseconds{2} );
+  for( uint32_t i{}; i != combiner_type::clock_check_interval - 2; ++i )
+    combiner.push( 3u );
+  BOOST_TEST( combiner.staged() == combiner_type::clock_check_interval - 1 );
+  combiner.push( 4u );
+  BOOST_TEST( combiner.staged() == 0u );
+  BOOST_TEST( queue.size() == 1 + combiner_type::clock_check_interval );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( write_combiner_test_failed_flush )
+{
+  counting_resource_t resource;
+    {
+    ampi::pmr::fifo_queue_t<std::string> queue{ &resource };
+    ampi::write_combiner_t<ampi::pmr::fifo_queue_t<std::string>> combiner{ queue, 1000, std::chrono::hours{1} };
+    for( uint32_t i{}; i != 150; ++i )
+      combiner.push( std::to_string( i ) );
+    //envelope and node are allocated per element, so allocation fails in third slice and two slices stay published
+    resource.fail_after = 280;
+    BOOST_CHECK_THROW( combiner.flush(), std::bad_alloc );
+    BOOST_TEST( queue.size() == 128 );
+    BOOST_TEST( combiner.staged() == 22u );
+    resource.fail_after = -1;
+    combiner.flush();
+    bool in_order { true };
+    for( uint32_t i{}; i != 150; ++i )
+      in_order = in_order && queue.pull().first == std::to_string( i );
+    BOOST_TEST( in_order );
+    }
+    {
+    ampi::pmr::afifo_t<std::string> queue{ &resource };
+    ampi::write_combiner_t<ampi::pmr::afifo_t<std::string>> combiner{ queue, 1000, std::chrono::hours{1} };
+    for( uint32_t i{}; i != 50; ++i )
+      combiner.push( std::to_string( i ) );
+    //chain is published at once, nothing leaves buffer
+    resource.fail_after = 30;
+    BOOST_CHECK_THROW( combiner.flush(), std::bad_alloc );
+    BOOST_TEST( queue.empty() );
+    BOOST_TEST( combiner.staged() == 50u );
+    resource.fail_after = -1;
+    combiner.flush();
+    bool in_order { true };
+    auto [list, success] = queue.pull();
+    BOOST_TEST( success );
+    for( uint32_t i{}; i != 50; ++i )
+      in_order = in_order && list.pull().first == std::to_string( i );
+    BOOST_TEST( in_order );
+    combiner.push( std::string{ "dropped" } );
+    resource.fail_after = 0;
+    }
+  //destructor swallowed failure of final flush and nothing leaked
+  BOOST_TEST( resource.outstanding.load() == 0 );
+  resource.fail_after = -1;
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( write_combiner_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  constexpr uint32_t number_of_threads { 4 };
+  constexpr uint32_t number_of_messages { 100001 };
+  ampi::fifo_queue_t<uint32_t> fifo;
+  ampi::afifo_t<uint32_t> afifo;
+  auto producer = [&]( uint32_t thread_id )
+    {
+    //thread_local buffers are flushed at thread exit
+    thread_local ampi::write_combiner_t<ampi::fifo_queue_t<uint32_t>> fifo_combiner{ fifo, 32 };
+    thread_local ampi::write_combiner_t<ampi::afifo_t<uint32_t>> afifo_combiner{ afifo, 32 };
+    for( uint32_t i{}; i != number_of_messages; ++i )
+      {
+      fifo_combiner.push( ( thread_id << 24 ) | i );
+      afifo_combiner.push( ( thread_id << 24 ) | i );
+      }
+    };
+  std::vector<std::thread> threads;
+  for( uint32_t i{}; i != number_of_threads; ++i )
+    threads.emplace_back( producer, i );
+  for( auto & t : threads )
+    t.join();
+
+  //per producer order is kept in both queues
+  std::vector<uint32_t> next( number_of_threads );
+  bool in_order { true };
+  uint32_t received {};
+  for( auto result = fifo.pull(); result.second; result = fifo.pull() )
+    {
+    in_order = in_order && ( result.first & 0xFFFFFF ) == next[ result.first >> 24 ]++;
+    ++received;
+    }
+  BOOST_TEST( in_order );
+  BOOST_TEST( received == number_of_threads * number_of_messages );
+
+  std::fill( next.begin(), next.end(), 0 );
+  received = 0;
+  auto [list, success] = afifo.pull();
+  BOOST_TEST( success );
+  for( auto result = list.pull(); result.second; result = list.pull() )
+    {
+    in_order = in_order && ( result.first & 0xFFFFFF ) == next[ result.first >> 24 ]++;
+    ++received;
+    }
+  BOOST_TEST( in_order );
+  BOOST_TEST( received == number_of_threads * number_of_messages );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( fan_in_queue_test_single )
+{
+  ampi::fan_in_queue_t<uint32_t> queue{ 6, 2, true };
+  BOOST_TEST( queue.lane_capacity() == 8u );
+  BOOST_TEST( queue.pull().second == false );
+  for( uint32_t i{}; i != 8; ++i )
+    BOOST_TEST_REQUIRE( queue.push( i ) );
+  //lane is full
+  BOOST_TEST( queue.push( 8u ) == false );
+  BOOST_TEST( queue.lane_count() == 1u );
+  {
+  auto producer { queue.make_producer() };
+  BOOST_TEST( bool(producer) );
+  //no more lanes
+  BOOST_TEST( bool(queue.make_producer()) == false );
+  for( uint32_t i{100}; i != 104; ++i )
+    BOOST_TEST_REQUIRE( producer.push( i ) );
+  }
+  //released lane is reusable and keeps pending elements
+  BOOST_TEST( queue.size() == 12 );
+  BOOST_TEST( bool(queue.make_producer()) );
+
+  //ordered merge follows push time
+  for( uint32_t i{}; i != 8; ++i )
+    BOOST_TEST_REQUIRE( queue.pull_ordered().first == i );
+  for( uint32_t i{100}; i != 104; ++i )
+    BOOST_TEST_REQUIRE( queue.pull_ordered().first == i );
+  BOOST_TEST( queue.empty() );
+
+  //batch limit per lane
+  for( uint32_t i{}; i != 8; ++i )
+    queue.push( i );
+  std::vector<uint32_t> consumed;
+  BOOST_TEST( queue.consume( [&]( uint32_t value ){ consumed.push_back( value ); }, 3 ) == 3 );
+  BOOST_TEST( queue.consume( [&]( uint32_t value ){ consumed.push_back( value ); } ) == 5 );
+  for( uint32_t i{}; i != 8; ++i )
+    BOOST_TEST_REQUIRE( consumed[i] == i );
+
+  //lane claimed by push is given back when thread exits
+  ampi::fan_in_queue_t<uint32_t> single_lane{ 4, 1 };
+  std::thread( [&]{ single_lane.push( 1u ); } ).join();
+  BOOST_TEST( single_lane.push( 2u ) );
+  BOOST_TEST( single_lane.pull().first == 1u );
+  BOOST_TEST( single_lane.pull().first == 2u );
+
+  //thread outlives queues it pushed to
+  bool pushed { true };
+  std::thread( [&pushed]
+    {
+    for( uint32_t i{}; i != 100; ++i )
+      {
+      ampi::fan_in_queue_t<uint32_t> transient{ 4, 1 };
+      pushed = pushed && transient.push( i );
+      }
+    } ).join();
+  BOOST_TEST( pushed );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( fan_in_queue_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  constexpr uint32_t number_of_threads { 4 };
+  constexpr uint32_t number_of_messages { 100001 };
+  ampi::fan_in_queue_t<uint32_t> queue{ 256, number_of_threads };
+  auto producer = [&]( uint32_t thread_id )
+    {
+    for( uint32_t i{}; i != number_of_messages; ++i )
+      while( !queue.push( ( thread_id << 24 ) | i ) )
+        std::this_thread::yield();
+    };
+  std::vector<std::thread> threads;
+  for( uint32_t i{}; i != number_of_threads; ++i )
+    threads.emplace_back( producer, i );
+
+  std::vector<uint32_t> next( number_of_threads );
+  bool in_order { true };
+  uint32_t received {};
+  while( received != number_of_threads * number_of_messages )
+    {
+    auto const count = queue.consume( [&]( uint32_t value )
+      { in_order = in_order && ( value & 0xFFFFFF ) == next[ value >> 24 ]++; }, 32 );
+    received += uint32_t( count );
+    if( count == 0 )
+      std::this_thread::yield();
+    }
+  for( auto & t : threads )
+    t.join();
+  BOOST_TEST( in_order );
+  BOOST_TEST( queue.empty() );
+  BOOST_TEST( queue.lane_count() == number_of_threads );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( partitioned_queue_test_single )
+{
+  ampi::partitioned_queue_t<uint32_t,uint32_t> queue{ 4, 2, false };
+  for( uint32_t i{}; i != 40; ++i )
+    queue.push( i % 8, i );
+  BOOST_TEST( queue.size() == 40 );
+  BOOST_TEST( queue.partition( queue.partition_of( 5 ) ).size() == 10 );
+
+  //consumer 0 owns partitions 0 and 2 only
+  std::vector<uint32_t> consumed;
+  while( queue.consume( 0, [&]( uint32_t value ){ consumed.push_back( value ); }, 3 ) != 0 );
+  BOOST_TEST( consumed.size() == 20u );
+  bool owned { true };
+  for( uint32_t value : consumed )
+    owned = owned && queue.partition_of( value % 8 ) % 2 == 0;
+  BOOST_TEST( owned );
+  BOOST_TEST( queue.size() == 20 );
+
+  //with stealing consumer 0 drains partitions of absent consumer 1
+  ampi::partitioned_queue_t<uint32_t,uint32_t> stealing{ 4, 2 };
+  for( uint32_t i{}; i != 40; ++i )
+    stealing.push( i % 8, i );
+  std::vector<uint32_t> next( 8 );
+  bool in_order { true };
+  uint32_t received {};
+  while( auto count = stealing.consume( 0, [&]( uint32_t value ){ in_order = in_order && value / 8 == next[ value % 8 ]++; } ) )
+    received += uint32_t( count );
+  BOOST_TEST( in_order );
+  BOOST_TEST( received == 40u );
+  BOOST_TEST( stealing.empty() );
+}
+//----------------------------------------------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE( partitioned_queue_test_multiple_threads, * boost::unit_test::timeout(60) )
+{
+  constexpr uint32_t number_of_producers { 2 };
+  constexpr uint32_t number_of_consumers { 3 };
+  constexpr uint32_t number_of_keys { 16 };
+  constexpr uint32_t number_of_messages { 50000 };
+  ampi::partitioned_queue_t<uint32_t,uint32_t> queue{ 6, number_of_consumers };
+  //key is owned by single producer so per key sequence is known, value is ( sequence << 8 ) | key
+  auto producer = [&]( uint32_t thread_id )
+    {
+    std::vector<uint32_t> sequence( number_of_keys );
+    for( uint32_t i{}; i != number_of_messages; ++i )
+      {
+      uint32_t const key { ( i % ( number_of_keys / number_of_producers ) ) * number_of_producers + thread_id };
+      queue.push( key, ( sequence[key]++ << 8 ) | key );
+      }
+    };
+  //written only under partition lease which orders accesses between consumers
+  std::vector<uint32_t> next( number_of_keys );
+  std::atomic<bool> in_order { true };
+  std::atomic<uint32_t> received {};
+  auto consumer = [&]( uint32_t consumer_id )
+    {
+    while( received.load() != number_of_producers * number_of_messages )
+      {
+      auto const count = queue.consume( consumer_id, [&]( uint32_t value )
+        {
+        if( ( value >> 8 ) != next[ value & 0xFF ]++ )
+          in_order = false;
+        }, 16 );
+      received += uint32_t( count );
+      if( count == 0 )
+        std::this_thread::yield();
+      }
+    };
+  std::vector<std::thread> threads;
+  for( uint32_t i{}; i != number_of_consumers; ++i )
+    threads.emplace_back( consumer, i );
+  for( uint32_t i{}; i != number_of_producers; ++i )
+    threads.emplace_back( producer, i );
+  for( auto & t : threads )
+    t.join();
+  BOOST_TEST( in_order.load() );
+  BOOST_TEST( queue.empty() );
+}
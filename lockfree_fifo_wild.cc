@@ -3,6 +3,8 @@
 #include <numeric>
 #include <future>
 #include <chrono>
+#include <vector>
+#include <random>
 
 using std::chrono::microseconds;
 using std::chrono::milliseconds;
@@ -24,10 +26,9 @@ struct message_t
   bool operator != ( message_t const & rh ) const noexcept { return id != rh.id; }
   };
   
-int main()
+template<typename fifo_type>
+static void run_fifo_benchmark( char const * name )
 {
-  using fifo_type = ampi::fifo_queue_t<message_t>;
-  
   fifo_type queue;
   uint32_t number_of_messages= 0x1FFFFF;
   uint32_t number_of_messages2= 0x1AFFFF;
@@ -71,17 +72,126 @@ int main()
                            catch(...){}
                             }, number_of_messages + number_of_messages2 );
   auto tmbeg{ clock_type::now() };
-  ampi::atomic_add_fetch( &run, true, ampi::memorder::relaxed );
+  ampi::atomic_store( &run, true, ampi::memorder::relaxed );
 //   printf("flags set\n");
   sender.get();
 //   printf("sender finished\n");
   uint32_t sum = reciver.get() + reciver2.get();
   auto tmend{ clock_type::now() };
   auto dur{ std::chrono::duration_cast<milliseconds>(tmend-tmbeg) };
-  printf("recivers finished %u == %u\n dur %lu\n",
+  printf("%s recivers finished %u == %u\n dur %lu\n",
+         name,
          sum, number_of_messages+number_of_messages2,
          dur.count()
         );
-//   BOOST_TEST( sum == (number_of_messages+number_of_messages2) );
+}
+
+// per operation latency, every thread pushes and pulls in turn so queue stays short and threads contend on both ends
+template<typename fifo_type>
+static void run_latency_benchmark( char const * name, fifo_type & queue )
+{
+  constexpr uint32_t number_of_threads = 4;
+  constexpr uint32_t number_of_ops = 0x3FFFF;
+  
+  bool run {};
+  auto worker = [&queue, &run]( uint32_t thread_id )
+                  {
+                  while(! ampi::atomic_load( &run, ampi::memorder::relaxed) )
+                    ampi::sleep(1);
+                  std::vector<uint64_t> samples;
+                  samples.reserve( number_of_ops * 2 );
+                  for( uint32_t i{}; i != number_of_ops; ++i )
+                    {
+                    auto tm0{ clock_type::now() };
+                    ampi::push( queue, message_t { (thread_id << 24) | i } );
+                    auto tm1{ clock_type::now() };
+                    auto [result, succeed] = ampi::pull( queue );
+                    auto tm2{ clock_type::now() };
+                    samples.emplace_back( std::chrono::duration_cast<std::chrono::nanoseconds>(tm1-tm0).count() );
+                    if( succeed )
+                      samples.emplace_back( std::chrono::duration_cast<std::chrono::nanoseconds>(tm2-tm1).count() );
+                    }
+                  return samples;
+                  };
+  std::vector<std::future<std::vector<uint64_t>>> threads;
+  for( uint32_t i{}; i != number_of_threads; ++i )
+    threads.emplace_back( std::async(std::launch::async, worker, i ) );
+  ampi::atomic_store( &run, true, ampi::memorder::relaxed );
+  std::vector<uint64_t> samples;
+  for( auto & thread : threads )
+    {
+    auto thread_samples{ thread.get() };
+    samples.insert( samples.end(), thread_samples.begin(), thread_samples.end() );
+    }
+  std::sort( samples.begin(), samples.end() );
+  auto percentile = [&samples]( double p ) { return samples[ static_cast<std::size_t>( p * double(samples.size() - 1) ) ]; };
+  printf("%s latency ns p50 %lu p99 %lu p99.99 %lu max %lu\n",
+         name, percentile(0.5), percentile(0.99), percentile(0.9999), samples.back() );
+}
+
+// deep backlog, single thread fills queue with millions of nodes then drains it chasing node pointers
+template<typename fifo_type>
+static void run_drain_benchmark( char const * name, fifo_type & queue )
+{
+  constexpr uint32_t number_of_messages = 0x3FFFFF;
+  for( uint32_t i{}; i != number_of_messages; ++i )
+    ampi::push( queue, message_t { i } );
+  auto tmbeg{ clock_type::now() };
+  uint32_t recived_count{};
+  while( ampi::pull( queue ).second )
+    ++recived_count;
+  auto dur{ std::chrono::duration_cast<milliseconds>( clock_type::now() - tmbeg ) };
+  printf("%s drained %u == %u dur %lu\n", name, recived_count, number_of_messages, dur.count() );
+}
+
+// node access only, nodes taken from resource are linked in random order and walked once, without queue reclaim work
+// time is dominated by cache and tlb misses which huge pages reduce
+static void run_node_walk_benchmark( char const * name, std::pmr::memory_resource & resource )
+{
+  using node_type = ampi::lifo_node_t<message_t>;
+  constexpr uint32_t number_of_nodes = 0x3FFFFF;
+  std::pmr::polymorphic_allocator<node_type> allocator{ &resource };
+  std::vector<node_type *> nodes( number_of_nodes );
+  for( uint32_t i{}; i != number_of_nodes; ++i )
+    nodes[i] = ampi::allocate_node<node_type>( allocator, message_t{ i } );
+  std::shuffle( nodes.begin(), nodes.end(), std::mt19937_64{ 1 } );
+  for( uint32_t i{ 1 }; i != number_of_nodes; ++i )
+    nodes[i - 1]->next = nodes[i];
+  nodes.back()->next = nullptr;
+  auto tmbeg{ clock_type::now() };
+  uint64_t sum{};
+  for( node_type * node{ nodes.front() }; node != nullptr; node = node->next )
+    sum += node->value.id;
+  auto dur{ std::chrono::duration_cast<milliseconds>( clock_type::now() - tmbeg ) };
+  printf("%s walked %lu == %lu dur %lu\n", name, sum, ( uint64_t(number_of_nodes) - 1 ) * number_of_nodes / 2, dur.count() );
+  for( node_type * node : nodes )
+    ampi::deallocate_node( allocator, node );
+}
+
+int main()
+{
+  run_fifo_benchmark<ampi::fifo_queue_t<message_t>>( "fifo_queue_t" );
+  run_fifo_benchmark<ampi::fc_fifo_t<message_t>>( "fc_fifo_t" );
+  
+  ampi::fifo_queue_t<message_t> fifo_queue;
+  run_latency_benchmark( "fifo_queue_t", fifo_queue );
+  ampi::wf_fifo_t<message_t> wf_fifo{ 1024, 8 };
+  run_latency_benchmark( "wf_fifo_t", wf_fifo );
+
+    {
+    ampi::fifo_queue_t<message_t> heap_fifo;
+    run_drain_benchmark( "fifo_queue_t heap", heap_fifo );
+    }
+    {
+    ampi::huge_page_resource_t arena{ std::size_t{512} << 20 };
+    ampi::pmr::fifo_queue_t<message_t> arena_fifo{ &arena };
+    run_drain_benchmark( arena.huge_pages() ? "fifo_queue_t huge page arena" : "fifo_queue_t arena", arena_fifo );
+    }
+
+  run_node_walk_benchmark( "node walk heap", *std::pmr::new_delete_resource() );
+    {
+    ampi::huge_page_resource_t arena{ std::size_t{512} << 20 };
+    run_node_walk_benchmark( arena.huge_pages() ? "node walk huge page arena" : "node walk arena", arena );
+    }
 return 0;  
 }